@@ -0,0 +1,137 @@
+/*
+  benchmarkHotPaths
+
+  Measures the time of the calls that dominate a write cycle of the ThingSpeak Communication Library for Arduino:
+  setField() for each value type, writeFields(), readRaw() and, except on the Uno, addSample().  Requests go to a
+  loopback client that answers at once, so the numbers are the cost of the library itself, without any network.
+
+  The results are printed to the serial monitor in microseconds and CPU cycles per call.  On AVR boards the free SRAM
+  (between heap and stack) is printed as well; flash and static SRAM use are reported by the IDE when compiling.
+  Run it before and after a change to the library to compare.
+
+  Documentation for the ThingSpeak Communication Library for Arduino is in the README.md folder where the library was installed.
+  See https://www.mathworks.com/help/thingspeak/index.html for the full ThingSpeak documentation.
+
+  For licensing information, see the accompanying license file.
+
+  Copyright 2026, The MathWorks, Inc.
+*/
+
+#include <Client.h>
+
+#define ITERATIONS 100
+
+// Client that answers every request at once with a fixed response
+class LoopbackClient : public Client
+{
+  public:
+    const char * response = "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\n3.14";
+
+    int connect(IPAddress ip, uint16_t port) { return open(); }
+    int connect(const char * host, uint16_t port) { return open(); }
+    size_t write(uint8_t c) { return 1; }
+    size_t write(const uint8_t * buf, size_t size) { return size; }
+    int available() { return isOpen ? strlen(response) - position : 0; }
+    int read() { return (available() > 0) ? response[position++] : -1; }
+    int read(uint8_t * buf, size_t size)
+    {
+      size_t count = 0;
+      while(count < size && available() > 0) buf[count++] = response[position++];
+      return count;
+    }
+    int peek() { return (available() > 0) ? response[position] : -1; }
+    void flush() {}
+    void stop() { isOpen = false; }
+    uint8_t connected() { return isOpen; }
+    operator bool() { return isOpen; }
+
+  private:
+    bool isOpen = false;
+    size_t position = 0;
+
+    int open()
+    {
+      isOpen = true;
+      position = 0;
+      return 1;
+    }
+};
+
+LoopbackClient client;
+
+#include <ThingSpeak.h> // always include thingspeak header file after other header files and custom macros
+
+unsigned long myChannelNumber = 1;
+const char * myWriteAPIKey = "XXXXXXXXXXXXXXXX";
+
+#ifdef ARDUINO_ARCH_AVR
+  extern char * __brkval;
+  extern char __heap_start;
+
+  int freeMemory()
+  {
+    char top;
+    return &top - (__brkval ? __brkval : &__heap_start);
+  }
+#endif
+
+void report(const char * name, unsigned long totalMicros)
+{
+  float perCall = (float)totalMicros / ITERATIONS;
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(perCall, 1);
+  Serial.print(" us, ");
+  Serial.print(perCall * (F_CPU / 1000000UL), 0);
+  Serial.print(" cycles");
+  #ifdef ARDUINO_ARCH_AVR
+    Serial.print(", free SRAM ");
+    Serial.print(freeMemory());
+  #endif
+  Serial.println();
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  while(!Serial); // for the Arduino Leonardo/Micro only
+  ThingSpeak.begin(client);
+}
+
+void loop()
+{
+  unsigned long start = micros();
+  for(int i = 0; i < ITERATIONS; i++) ThingSpeak.setField(1, 23.5f + i);
+  report("setField(float)", micros() - start);
+
+  start = micros();
+  for(int i = 0; i < ITERATIONS; i++) ThingSpeak.setField(2, i);
+  report("setField(int)", micros() - start);
+
+  start = micros();
+  for(int i = 0; i < ITERATIONS; i++) ThingSpeak.setField(3, "sensor ok");
+  report("setField(const char *)", micros() - start);
+
+  start = micros();
+  for(int i = 0; i < ITERATIONS; i++)
+  {
+    ThingSpeak.setField(1, 23.5f + i);
+    ThingSpeak.setField(2, i);
+    ThingSpeak.writeFields(myChannelNumber, myWriteAPIKey);
+  }
+  report("setField x2 + writeFields", micros() - start);
+
+  start = micros();
+  for(int i = 0; i < ITERATIONS; i++) ThingSpeak.readRaw(myChannelNumber, "/fields/1/last");
+  report("readRaw", micros() - start);
+
+  #ifndef ARDUINO_AVR_UNO
+    start = micros();
+    for(int i = 0; i < ITERATIONS; i++) ThingSpeak.addSample(1, 23.5f + i);
+    report("addSample", micros() - start);
+    ThingSpeak.flushAggregates(); // start the next loop with an empty window
+  #endif
+
+  Serial.println();
+  delay(10000);
+}
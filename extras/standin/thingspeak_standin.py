@@ -0,0 +1,302 @@
+#!/usr/bin/env python3
+"""
+thingspeak_standin.py
+
+Local stand-in for the ThingSpeak server, to run the ThingSpeak Communication Library for Arduino against without a
+ThingSpeak account or internet access, e.g. for regression and load tests.
+
+It keeps channels in memory and serves the requests the library sends:
+  POST/GET /update                                    write an entry, answered with its entry ID (0 if rate limited)
+  POST     /channels/<id>/bulk_update.csv             write several entries (time_format=absolute)
+  GET      /channels/<id>/fields/<n>/last[.txt|.json] last value of a field
+  GET      /channels/<id>/feeds/last[.txt|.json]      last entry
+  GET      /channels/<id>/feeds.json, feeds.csv       entries, with results, start and end
+
+Channels are known by their write API key.  The channels of the sketches in extras/test are known by default, more can
+be added with --channel.  Read API keys are not checked.  Every response carries a Date header, so the clock of the
+library is synced as it is by ThingSpeak.
+
+Point the library at it by defining THINGSPEAK_URL and THINGSPEAK_PORT_NUMBER before including ThingSpeak.h, or with
+ThingSpeak.setServer().  Example, emulating a 15 second rate limit, 200 ms of latency and 5% server errors:
+
+  python3 thingspeak_standin.py --port 8080 --rate-limit 15 --latency 200 --error-rate 0.05
+
+Requires Python 3.7 or later, and nothing outside the standard library.
+
+For licensing information, see the accompanying license file.
+
+Copyright 2026, The MathWorks, Inc.
+"""
+
+import argparse
+import csv
+import io
+import json
+import random
+import re
+import sys
+import threading
+import time
+from datetime import datetime, timezone
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlsplit
+
+FIELDS = ["field%d" % i for i in range(1, 9)]
+LOCATION = ["latitude", "longitude", "elevation"]
+BULK_COLUMNS = FIELDS + LOCATION + ["status"]   # after the timestamp: TIMESTAMP,FIELD1,...,FIELD8,LATITUDE,LONGITUDE,ELEVATION,STATUS
+
+# Channels of the sketches in extras/test, as channel:write API key
+DEFAULT_CHANNELS = ["1070863:UI7FSU4O8ZJ5BM8O", "209615:KI8B7DJTWXLZ6EBV", "209617:514SX5OBP2OFEPL2"]
+
+
+def parse_time(text):
+    """Return the datetime of an ISO 8601 time, a "YYYY-MM-DD HH:MM:SS" time (taken as UTC) or a Unix time, or None."""
+    text = text.strip()
+    if text.isdigit():
+        return datetime.fromtimestamp(int(text), timezone.utc)
+    text = re.sub(r"(Z| UTC)$", "+00:00", text)
+    try:
+        value = datetime.fromisoformat(text.replace("T", " "))
+    except ValueError:
+        return None
+    return value.replace(tzinfo=timezone.utc) if value.tzinfo is None else value.astimezone(timezone.utc)
+
+
+class Store:
+    """Entries of every channel, and the time of the last accepted write for the rate limit."""
+
+    def __init__(self, channels, rate_limit):
+        self.lock = threading.Lock()
+        self.rate_limit = rate_limit
+        self.write_keys = {}    # write API key -> channel ID
+        self.entries = {}       # channel ID -> list of entries
+        self.last_write = {}    # channel ID -> time.monotonic() of the last accepted write
+        for channel in channels:
+            channel_id, _, write_key = channel.partition(":")
+            self.entries[int(channel_id)] = []
+            self.write_keys[write_key] = int(channel_id)
+
+    def channel_of(self, write_key):
+        return self.write_keys.get(write_key)
+
+    def add(self, channel_id, updates, rate_limited=True):
+        """Append updates (dicts of column values) and return the ID of the last entry, or 0 if rate limited."""
+        with self.lock:
+            now = time.monotonic()
+            last = self.last_write.get(channel_id)
+            if rate_limited and self.rate_limit > 0 and last is not None and now - last < self.rate_limit:
+                return 0
+            entries = self.entries[channel_id]
+            for values in updates:
+                entry = {"created_at": values.get("created_at") or datetime.now(timezone.utc), "entry_id": len(entries) + 1}
+                for column in BULK_COLUMNS:
+                    entry[column] = values.get(column) or None
+                entries.append(entry)
+            self.last_write[channel_id] = now
+            return entries[-1]["entry_id"]
+
+    def feed(self, channel_id, results=100, start=None, end=None):
+        """Return the last results entries between start and end, oldest first, or None if the channel is unknown."""
+        with self.lock:
+            entries = self.entries.get(channel_id)
+            if entries is None:
+                return None
+            selected = [e for e in entries if (start is None or e["created_at"] >= start) and (end is None or e["created_at"] <= end)]
+            return selected[-results:] if results > 0 else []
+
+    def used_fields(self, channel_id):
+        with self.lock:
+            return [f for f in FIELDS if any(e[f] is not None for e in self.entries.get(channel_id, []))]
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"   # keep connections open unless the client asks otherwise, as ThingSpeak does
+    server_version = "ThingSpeakStandIn/1.0"
+    store = None
+    options = None
+
+    # Routing
+
+    def do_GET(self):
+        self.route("GET")
+
+    def do_POST(self):
+        self.route("POST")
+
+    def route(self, method):
+        url = urlsplit(self.path)
+        query = {k: v[-1] for k, v in parse_qs(url.query, keep_blank_values=True).items()}
+        length = int(self.headers.get("Content-Length") or 0)
+        body = self.rfile.read(length).decode("utf-8", "replace") if length > 0 else ""
+        if method == "POST":
+            query.update({k: v[-1] for k, v in parse_qs(body, keep_blank_values=True).items()})
+
+        if self.options.latency > 0:
+            time.sleep(self.options.latency / 1000.0)
+        if random.random() < self.options.drop_rate:
+            # Close without a response, like a server that dropped an idle connection
+            self.close_connection = True
+            return
+        if random.random() < self.options.error_rate:
+            return self.reply(500, "Internal Server Error", "text/plain")
+
+        match = re.fullmatch(r"/channels/(\d+)(/.*)", url.path)
+        if url.path == "/update" or url.path == "/update.json":
+            return self.update(query)
+        if match and method == "POST" and match.group(2) == "/bulk_update.csv":
+            return self.bulk_update(int(match.group(1)), query)
+        if match and method == "GET":
+            return self.read(int(match.group(1)), match.group(2), query)
+        self.reply(404, "-1", "text/plain")
+
+    # Writes
+
+    def update(self, query):
+        channel_id = self.store.channel_of(self.headers.get("X-THINGSPEAKAPIKEY") or query.get("api_key", ""))
+        if channel_id is None:
+            return self.reply(400, "0", "text/plain")
+        values = {k: v for k, v in query.items() if k in BULK_COLUMNS}
+        if "created_at" in query:
+            values["created_at"] = parse_time(query["created_at"])
+            if values["created_at"] is None:
+                return self.reply(400, "0", "text/plain")
+        self.reply(200, str(self.store.add(channel_id, [values])), "text/plain")
+
+    def bulk_update(self, channel_id, query):
+        if self.store.channel_of(query.get("write_api_key", "")) != channel_id:
+            return self.reply(401, '{"status":"401","error":{"error_code":"error_auth_required"}}', "application/json")
+        if query.get("time_format") != "absolute":
+            return self.reply(400, '{"status":"400","error":{"error_code":"error_time_format"}}', "application/json")
+        updates = []
+        for sample in query.get("updates", "").split("|"):
+            cells = sample.split(",")
+            created_at = parse_time(cells[0])
+            if created_at is None:
+                return self.reply(400, '{"status":"400","error":{"error_code":"error_bad_timestamp"}}', "application/json")
+            values = dict(zip(BULK_COLUMNS, cells[1:]))
+            values["created_at"] = created_at
+            updates.append(values)
+        # Bulk updates have a rate limit of their own on ThingSpeak, which isn't emulated
+        self.store.add(channel_id, updates, rate_limited=False)
+        self.reply(202, '{"success":true}', "application/json")
+
+    # Reads
+
+    def read(self, channel_id, path, query):
+        match = re.fullmatch(r"/fields/(\d+)/last(\.txt|\.json)?", path)
+        if match:
+            return self.read_field(channel_id, int(match.group(1)), match.group(2) == ".json")
+        match = re.fullmatch(r"/feeds/last(\.txt|\.json)?", path)
+        if match:
+            entries = self.store.feed(channel_id, 1)
+            if entries is None:
+                return self.reply(404, "-1", "text/plain")
+            if not entries:
+                return self.reply(200, "-1", "application/json")
+            return self.reply(200, json.dumps(self.format_entry(channel_id, entries[0], query), separators=(",", ":")), "application/json")
+        match = re.fullmatch(r"/feeds\.(json|csv)", path)
+        if match:
+            return self.read_feed(channel_id, match.group(1), query)
+        self.reply(404, "-1", "text/plain")
+
+    def read_field(self, channel_id, field, as_json):
+        if field < 1 or field > 8:
+            return self.reply(400, "-1", "text/plain")
+        entries = self.store.feed(channel_id, 1)
+        if entries is None:
+            return self.reply(404, "-1", "text/plain")
+        if not entries:
+            return self.reply(200, "-1", "text/plain")
+        value = entries[0]["field%d" % field]
+        if as_json:
+            entry = {"created_at": self.format_time(entries[0]["created_at"]), "entry_id": entries[0]["entry_id"], "field%d" % field: value}
+            return self.reply(200, json.dumps(entry, separators=(",", ":")), "application/json")
+        self.reply(200, value or "", "text/plain")
+
+    def read_feed(self, channel_id, kind, query):
+        try:
+            results = min(int(query.get("results", 100)), 8000)
+        except ValueError:
+            results = 100
+        start = parse_time(query["start"]) if query.get("start") else None
+        end = parse_time(query["end"]) if query.get("end") else None
+        entries = self.store.feed(channel_id, results, start, end)
+        if entries is None:
+            return self.reply(404, "-1", "text/plain")
+
+        if kind == "json":
+            feeds = [self.format_entry(channel_id, e, query) for e in entries]
+            last_entry_id = entries[-1]["entry_id"] if entries else None
+            body = {"channel": {"id": channel_id, "last_entry_id": last_entry_id}, "feeds": feeds}
+            return self.reply(200, json.dumps(body, separators=(",", ":")), "application/json")
+
+        columns = ["created_at", "entry_id"] + self.store.used_fields(channel_id) + self.extra_columns(query)
+        out = io.StringIO()
+        writer = csv.writer(out, lineterminator="\n")
+        writer.writerow(columns)
+        for entry in entries:
+            row = [entry["created_at"].strftime("%Y-%m-%d %H:%M:%S UTC"), entry["entry_id"]]
+            writer.writerow(row + [entry[c] if entry[c] is not None else "" for c in columns[2:]])
+        self.reply(200, out.getvalue(), "text/csv")
+
+    def format_entry(self, channel_id, entry, query):
+        result = {"created_at": self.format_time(entry["created_at"]), "entry_id": entry["entry_id"]}
+        for column in self.store.used_fields(channel_id) + self.extra_columns(query):
+            result[column] = entry[column]
+        return result
+
+    @staticmethod
+    def extra_columns(query):
+        return (LOCATION if query.get("location") == "true" else []) + (["status"] if query.get("status") == "true" else [])
+
+    @staticmethod
+    def format_time(value):
+        return value.strftime("%Y-%m-%dT%H:%M:%SZ")
+
+    # Responses
+
+    def reply(self, status, body, content_type):
+        data = body.encode("utf-8")
+        self.send_response(status)
+        self.send_header("Content-Type", content_type + "; charset=utf-8")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def log_message(self, format, *args):
+        if not self.options.quiet:
+            sys.stderr.write("%s %s\n" % (self.address_string(), format % args))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Local stand-in for the ThingSpeak server.")
+    parser.add_argument("--host", default="0.0.0.0", help="address to listen on (default: all)")
+    parser.add_argument("--port", type=int, default=8080, help="port to listen on (default: 8080)")
+    parser.add_argument("--channel", action="append", default=[], metavar="ID:WRITEKEY",
+                        help="channel known by the server, in addition to those of the test sketches; may be repeated")
+    parser.add_argument("--rate-limit", type=float, default=0, metavar="SECONDS",
+                        help="shortest time between updates to a channel; sooner ones are answered with entry ID 0 (default: 0, none)")
+    parser.add_argument("--latency", type=float, default=0, metavar="MS", help="delay before every response (default: 0)")
+    parser.add_argument("--error-rate", type=float, default=0, metavar="FRACTION", help="fraction of requests answered with HTTP 500 (default: 0)")
+    parser.add_argument("--drop-rate", type=float, default=0, metavar="FRACTION",
+                        help="fraction of requests answered by closing the connection (default: 0)")
+    parser.add_argument("--idle-timeout", type=float, default=15, metavar="SECONDS",
+                        help="time an idle connection is kept open (default: 15)")
+    parser.add_argument("--quiet", action="store_true", help="don't log requests")
+    options = parser.parse_args()
+
+    Handler.store = Store(DEFAULT_CHANNELS + options.channel, options.rate_limit)
+    Handler.options = options
+    Handler.timeout = options.idle_timeout
+
+    server = ThreadingHTTPServer((options.host, options.port), Handler)
+    server.daemon_threads = True
+    sys.stderr.write("ThingSpeak stand-in listening on %s:%d\n" % (options.host, options.port))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -22,6 +22,11 @@
 //#define USE_WIFI101_SHIELD
 //#define USE_ETHERNET_SHIELD
 
+// Uncomment to run the tests against extras/standin/thingspeak_standin.py instead of api.thingspeak.com, with the
+// address of the computer that runs it
+//#define THINGSPEAK_URL "192.168.1.10"
+//#define THINGSPEAK_PORT_NUMBER 8080
+
 
 #if !defined(USE_WIFI101_SHIELD) && !defined(USE_ETHERNET_SHIELD) && !defined(ARDUINO_SAMD_MKR1000) && !defined(ARDUINO_AVR_YUN)
   #error "Uncomment the #define for either USE_WIFI101_SHIELD or USE_ETHERNET_SHIELD"
@@ -0,0 +1,725 @@
+#line 2 "testMockClient.ino"
+/*
+  testMockClient unit test
+
+  Unit Test for the timeout, retry and keep-alive behaviour, and the other request logic, of the ThingSpeak Communication
+  Library for Arduino, run against a scripted network instead of a real one.
+
+  The library runs on a virtual clock (TS_MILLIS / TS_DELAY) that only advances while it waits, and the MockClient below
+  delivers scripted responses with the latency, bandwidth and segment size of a network profile.  It keeps the start of
+  the last request, so that tests can check the bytes the library sent.  Results are therefore
+  the same on every board and every run, and no network hardware or ThingSpeak account is needed.  The time each request
+  takes on the virtual clock is checked against a baseline, so that a change that makes requests slower fails the test.
+
+  This test use the ArduinoUnit 2.1.0 unit test framework.  Visit https://github.com/mmurdoch/arduinounit to learn more.
+
+  ArduinoUnit does not support ESP8266 or ESP32 and therefor these tests will not compile for those platforms.
+
+  Documentation for the ThingSpeak Communication Library for Arduino is in the README.md folder where the library was installed.
+  See https://www.mathworks.com/help/thingspeak/index.html for the full ThingSpeak documentation.
+
+  For licensing information, see the accompanying license file.
+
+  Copyright 2026, The MathWorks, Inc.
+*/
+
+#include <ArduinoUnit.h>
+#include <Client.h>
+
+// Virtual clock that drives the library
+unsigned long virtualTime = 0;
+unsigned long virtualMillis() { return virtualTime; }
+void virtualDelay(unsigned long ms) { virtualTime += ms; }
+
+#define TS_MILLIS() virtualMillis()
+#define TS_DELAY(ms) virtualDelay(ms)
+
+// Network conditions emulated by MockClient
+typedef struct networkProfileRecord
+{
+  unsigned long connectMs;        // Time to open a connection
+  unsigned long latencyMs;        // Time from the end of the request to the first byte of the response
+  unsigned long bytesPerSecond;   // Bandwidth in both directions
+  unsigned int segmentBytes;      // Response bytes that arrive together
+}networkProfile;
+
+const networkProfile goodLAN = {5, 2, 1000000, 1460};
+const networkProfile lossyWiFi = {150, 80, 20000, 512};
+const networkProfile cellular2G = {1500, 600, 1500, 128};
+
+class MockClient : public Client
+{
+  public:
+    networkProfile profile = goodLAN;
+    const char * responses[4];      // Scripted responses, one per request
+    unsigned int responseCount = 0;
+    unsigned int failConnects = 0;  // Connect attempts that fail before one succeeds
+    size_t stallAt = 0;             // Response byte before which the server stalls, 0 for none
+    unsigned long stallMs = 0;
+    size_t disconnectAt = 0;        // Response byte at which the server drops the connection, 0 for none
+    bool closeIdle = false;         // Server closes the connection after each response, which only shows on the next request
+    unsigned int connects = 0;
+    unsigned int requests = 0;
+    char request[400];              // Start of the last request sent, zero terminated
+
+    void reset(const networkProfile & newProfile)
+    {
+      stop();
+      profile = newProfile;
+      responseCount = 0;
+      failConnects = 0;
+      stallAt = 0;
+      stallMs = 0;
+      disconnectAt = 0;
+      closeIdle = false;
+      connects = 0;
+      requests = 0;
+      request[0] = '\0';
+    }
+
+    int connect(IPAddress ip, uint16_t port) { return open(); }
+    int connect(const char * host, uint16_t port) { return open(); }
+
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t * buf, size_t size)
+    {
+      if(!isOpen) return 0;
+      if(responding && closeIdle)
+      {
+        isOpen = false;
+        return 0;
+      }
+      if(responding)
+      {
+        // A new request on a kept connection
+        responding = false;
+        requestBytes = 0;
+      }
+      for(size_t i = 0; i < size && requestBytes + i < sizeof(request) - 1; i++)
+      {
+        request[requestBytes + i] = buf[i];
+        request[requestBytes + i + 1] = '\0';
+      }
+      requestBytes += size;
+      requestEnd = virtualTime + requestBytes * 1000UL / profile.bytesPerSecond;
+      return size;
+    }
+
+    int available()
+    {
+      startResponse();
+      size_t arrived = position;
+      while(arrived < length && arrivalTime(arrived) <= virtualTime) arrived++;
+      return arrived - position;
+    }
+
+    int read()
+    {
+      uint8_t c;
+      return (1 == read(&c, 1)) ? c : -1;
+    }
+
+    int read(uint8_t * buf, size_t size)
+    {
+      startResponse();
+      size_t count = 0;
+      while(count < size && position < length)
+      {
+        // A blocking read waits for the byte to arrive
+        if(arrivalTime(position) > virtualTime)
+        {
+          if(0 != disconnectAt && position >= disconnectAt) break;
+          virtualTime = arrivalTime(position);
+        }
+        buf[count++] = response[position++];
+      }
+      return count;
+    }
+
+    int peek()
+    {
+      return (available() > 0) ? response[position] : -1;
+    }
+
+    void flush() {}
+
+    void stop()
+    {
+      isOpen = false;
+      response = NULL;
+    }
+
+    uint8_t connected()
+    {
+      if(!isOpen) return 0;
+      return (0 == disconnectAt || position < disconnectAt || !responding);
+    }
+
+    operator bool() { return isOpen; }
+
+  private:
+    bool isOpen = false;
+    bool responding = false;
+    const char * response = NULL;
+    size_t length = 0;
+    size_t position = 0;
+    size_t requestBytes = 0;
+    unsigned long requestEnd = 0;
+
+    int open()
+    {
+      connects++;
+      virtualTime += profile.connectMs;
+      if(failConnects > 0)
+      {
+        failConnects--;
+        return 0;
+      }
+      isOpen = true;
+      responding = false;
+      requestBytes = 0;
+      request[0] = '\0';
+      return 1;
+    }
+
+    void startResponse()
+    {
+      if(!isOpen || responding) return;
+      responding = true;
+      response = (requests < responseCount) ? responses[requests] : "";
+      requests++;
+      length = strlen(response);
+      if(0 != disconnectAt && disconnectAt < length) length = disconnectAt;
+      position = 0;
+    }
+
+    unsigned long arrivalTime(size_t index)
+    {
+      unsigned long segmentEnd = (index / profile.segmentBytes + 1) * (unsigned long)profile.segmentBytes;
+      unsigned long arrival = requestEnd + profile.latencyMs + segmentEnd * 1000UL / profile.bytesPerSecond;
+      if(0 != stallAt && index >= stallAt) arrival += stallMs;
+      return arrival;
+    }
+};
+
+MockClient client;
+
+#include <ThingSpeak.h> // always include thingspeak header file after other header files and custom macros
+
+unsigned long testChannelNumber = 1070863;
+const char * testChannelWriteAPIKey = "UI7FSU4O8ZJ5BM8O";
+const char * testChannelReadAPIKey = "KFCDPAOI8RHRRXZ6";
+
+const char * writeResponse = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: keep-alive\r\n\r\n12";
+const char * readResponse = "HTTP/1.1 200 OK\r\nContent-Length: 4\r\nConnection: keep-alive\r\n\r\n3.14";
+const char * feedResponse = "HTTP/1.1 200 OK\r\nContent-Length: 160\r\nConnection: keep-alive\r\n\r\n"
+                            "{\"created_at\":\"2026-10-19T10:00:00Z\",\"entry_id\":12,\"field1\":\"3.14\",\"field2\":\"-47\",\"field3\":null,"
+                            "\"latitude\":null,\"longitude\":null,\"elevation\":null,\"status\":\"ok\"}";
+
+// Time a request may take on the virtual clock under each profile
+#define BASELINE_LAN_MS 15
+#define BASELINE_WIFI_MS 300
+#define BASELINE_2G_MS 2600
+
+void startTest(const networkProfile & profile)
+{
+  client.reset(profile);
+  ThingSpeak.begin(client);
+}
+
+bool requestStartsWith(const char * text)
+{
+  return 0 == strncmp(client.request, text, strlen(text));
+}
+
+bool requestContains(const char * text)
+{
+  return NULL != strstr(client.request, text);
+}
+
+unsigned long timeWriteFields()
+{
+  client.responses[client.responseCount++] = writeResponse;
+  ThingSpeak.setField(1, 3.14159f);
+  ThingSpeak.setField(2, -47);
+  unsigned long start = virtualMillis();
+  if(TS_OK_SUCCESS != ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey)) return ULONG_MAX;
+  return virtualMillis() - start;
+}
+
+unsigned long timeReadRaw()
+{
+  client.responses[client.responseCount++] = readResponse;
+  unsigned long start = virtualMillis();
+  if(!ThingSpeak.readRaw(testChannelNumber, "/fields/1/last", testChannelReadAPIKey).equals("3.14")) return ULONG_MAX;
+  return virtualMillis() - start;
+}
+
+#ifndef ARDUINO_AVR_UNO
+  unsigned long timeReadMultipleFields()
+  {
+    client.responses[client.responseCount++] = feedResponse;
+    unsigned long start = virtualMillis();
+    if(TS_OK_SUCCESS != ThingSpeak.readMultipleFields(testChannelNumber, testChannelReadAPIKey)) return ULONG_MAX;
+    if(!ThingSpeak.getFieldAsString(2).equals("-47")) return ULONG_MAX;
+    return virtualMillis() - start;
+  }
+#endif
+
+/* This test case checks for the following:
+    - writeFields, readRaw and readMultipleFields (not on Uno) succeed under each network profile
+    - none of them takes longer than its baseline
+*/
+test(networkProfileCase)
+{
+  const networkProfile * profiles[] = {&goodLAN, &lossyWiFi, &cellular2G};
+  const unsigned long baselines[] = {BASELINE_LAN_MS, BASELINE_WIFI_MS, BASELINE_2G_MS};
+
+  for(int i = 0; i < 3; i++)
+  {
+    startTest(*profiles[i]);
+    assertLessOrEqual(timeWriteFields(), baselines[i]);
+    startTest(*profiles[i]);
+    assertLessOrEqual(timeReadRaw(), baselines[i]);
+    #ifndef ARDUINO_AVR_UNO
+      startTest(*profiles[i]);
+      assertLessOrEqual(timeReadMultipleFields(), baselines[i]);
+    #endif
+  }
+}
+
+/* This test case checks for the following:
+    - responses split into one byte segments are read completely
+*/
+test(fragmentationCase)
+{
+  networkProfile fragmented = lossyWiFi;
+  fragmented.segmentBytes = 1;
+  startTest(fragmented);
+  #ifdef ARDUINO_AVR_UNO
+    assertNotEqual(ULONG_MAX, timeReadRaw());
+  #else
+    assertNotEqual(ULONG_MAX, timeReadMultipleFields());
+    assertEqual(3.14f, ThingSpeak.getFieldAsFloat(1));
+  #endif
+}
+
+/* This test case checks for the following:
+    - a server that stalls in the middle of the body times out after TIMEOUT_MS_SERVERRESPONSE
+    - a server that drops the connection in the middle of the body is reported as an error
+*/
+test(stallAndDisconnectCase)
+{
+  startTest(goodLAN);
+  client.stallAt = strlen(readResponse) - 2;
+  client.stallMs = 10000;
+  client.responses[client.responseCount++] = readResponse;
+  unsigned long start = virtualMillis();
+  assertEqual(0, ThingSpeak.readLongField(testChannelNumber, 1, testChannelReadAPIKey));
+  assertEqual(TS_ERR_TIMEOUT, ThingSpeak.getLastReadStatus());
+  assertLessOrEqual(virtualMillis() - start, TIMEOUT_MS_SERVERRESPONSE + BASELINE_LAN_MS);
+
+  startTest(goodLAN);
+  client.disconnectAt = strlen(readResponse) - 2;
+  client.responses[client.responseCount++] = readResponse;
+  assertEqual(0, ThingSpeak.readLongField(testChannelNumber, 1, testChannelReadAPIKey));
+  assertNotEqual(TS_OK_SUCCESS, ThingSpeak.getLastReadStatus());
+}
+
+/* This test case checks for the following:
+    - a failed connect is reported without a request
+    - retryLastWrite() sends the write again after a failed connect (not on Uno, which has no retries)
+*/
+test(connectFailureCase)
+{
+  startTest(lossyWiFi);
+  client.failConnects = 1;
+  client.responses[client.responseCount++] = writeResponse;
+  ThingSpeak.setField(1, 42);
+  assertEqual(TS_ERR_CONNECT_FAILED, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+  assertEqual(0, client.requests);
+  #ifndef ARDUINO_AVR_UNO
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.retryLastWrite());
+    assertEqual(2, client.connects);
+  #endif
+}
+
+/* This test case checks for the following:
+    - a status line without a reason phrase is accepted, and the header after it is read
+*/
+test(statusLineCase)
+{
+  startTest(goodLAN);
+  client.responses[client.responseCount++] = "HTTP/1.1 200\r\nContent-Length: 4\r\n\r\n3.14";
+  assertTrue(ThingSpeak.readRaw(testChannelNumber, "/fields/1/last", testChannelReadAPIKey).equals("3.14"));
+  assertEqual(TS_OK_SUCCESS, ThingSpeak.getLastReadStatus());
+}
+
+/* This test case checks for the following:
+    - a numeric value longer than TS_NUMBER_LENGTH_MAX is reported as -101, not as a truncated number
+    - text that only starts with "inf" or "nan" is not read as INFINITY or NAN
+*/
+test(numberOverflowCase)
+{
+  startTest(goodLAN);
+  client.responses[client.responseCount++] = "HTTP/1.1 200 OK\r\nContent-Length: 32\r\n\r\n1.0000000000000000000000000005e3";
+  assertEqual(0.0f, ThingSpeak.readFloatField(testChannelNumber, 1, testChannelReadAPIKey));
+  assertEqual(TS_ERR_OUT_OF_RANGE, ThingSpeak.getLastReadStatus());
+
+  startTest(goodLAN);
+  client.responses[client.responseCount++] = "HTTP/1.1 200 OK\r\nContent-Length: 8\r\n\r\ninfrared";
+  client.responses[client.responseCount++] = "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\n-inf";
+  assertEqual(0.0f, ThingSpeak.readFloatField(testChannelNumber, 1, testChannelReadAPIKey));
+  assertEqual(TS_OK_SUCCESS, ThingSpeak.getLastReadStatus());
+  assertEqual((float)-INFINITY, ThingSpeak.readFloatField(testChannelNumber, 1, testChannelReadAPIKey));
+}
+
+#ifndef ARDUINO_AVR_UNO
+  /* This test case checks for the following:
+      - pollChannel() requests the last entry and returns 200 for a new entry_id
+      - a poll that is not due yet returns 304 without a request
+      - an unchanged entry_id returns 304 and backs off the poll interval
+  */
+  test(pollChannelCase)
+  {
+    startTest(goodLAN);
+    ThingSpeak.setPollInterval(15000, 60000);
+    ThingSpeak.setKeepAlive(30000);
+    client.responses[client.responseCount++] = feedResponse;
+    client.responses[client.responseCount++] = feedResponse;
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.pollChannel(testChannelNumber, testChannelReadAPIKey));
+    assertTrue(requestStartsWith("GET /channels/1070863/feeds/last.json?status=true&location=true HTTP/1.1\r\n"));
+    assertTrue(requestContains("X-THINGSPEAKAPIKEY: KFCDPAOI8RHRRXZ6\r\n"));
+    assertEqual(-47, ThingSpeak.getFieldAsInt(2));
+    
+    assertEqual(TS_OK_NOT_MODIFIED, ThingSpeak.pollChannel(testChannelNumber, testChannelReadAPIKey));
+    assertEqual(1, client.requests);
+    
+    virtualDelay(15000);
+    assertEqual(TS_OK_NOT_MODIFIED, ThingSpeak.pollChannel(testChannelNumber, testChannelReadAPIKey));
+    assertEqual(2, client.requests);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.getLastReadStatus());
+    assertEqual(22500UL, ThingSpeak.getPollInterval(testChannelNumber));
+    // The unchanged entry isn't downloaded, even with keep-alive
+    assertEqual(0, client.connected());
+    ThingSpeak.setPollInterval(TS_POLL_INTERVAL_MS_MIN, TS_POLL_INTERVAL_MS_MAX);
+    ThingSpeak.setKeepAlive(0);
+  }
+  
+  /* This test case checks for the following:
+      - the circuit opens after the threshold of failed connects, and then fails fast with -305 without connecting
+      - once the backoff elapsed, a successful probe closes the circuit and sends the update
+      - a threshold of 0 disables the breaker without valid backoff values
+  */
+  test(circuitBreakerCase)
+  {
+    startTest(goodLAN);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setCircuitBreaker(2, 1000, 4000));
+    client.failConnects = 2;
+    client.responses[client.responseCount++] = writeResponse;
+    for(int i = 0; i < 2; i++)
+    {
+      ThingSpeak.setField(1, i);
+      assertEqual(TS_ERR_CONNECT_FAILED, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    }
+    assertEqual(TS_CIRCUIT_OPEN, ThingSpeak.getCircuitState());
+    ThingSpeak.setField(1, 2);
+    assertEqual(TS_ERR_CIRCUIT_OPEN, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertEqual(2, client.connects);
+    
+    // The backoff is 1000 ms plus up to 25% jitter
+    virtualDelay(1250);
+    assertEqual(TS_CIRCUIT_HALF_OPEN, ThingSpeak.getCircuitState());
+    ThingSpeak.setField(1, 3);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertEqual(3, client.connects);
+    assertTrue(requestStartsWith("POST /update HTTP/1.1\r\n"));
+    assertTrue(requestContains("\r\n\r\nfield1=3&"));
+    assertEqual(TS_CIRCUIT_CLOSED, ThingSpeak.getCircuitState());
+    
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setCircuitBreaker(0, 0, 0));
+  }
+  
+  /* This test case checks for the following:
+      - retryLastWrite() is held back by the rate limit of the channel, without connecting
+      - once the limit allows it, the retry sends the same update
+  */
+  test(retryRateLimitCase)
+  {
+    startTest(goodLAN);
+    ThingSpeak.setRateLimit(15000);
+    virtualDelay(15000); // let the writes of earlier tests age out
+    client.responses[client.responseCount++] = writeResponse;
+    client.responses[client.responseCount++] = writeResponse;
+    ThingSpeak.setField(1, 1);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    
+    virtualDelay(15000);
+    client.failConnects = 1;
+    ThingSpeak.setField(1, 2);
+    assertEqual(TS_ERR_CONNECT_FAILED, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    ThingSpeak.setRateLimit(60000);
+    assertEqual(TS_ERR_NOT_INSERTED, ThingSpeak.retryLastWrite());
+    assertEqual(2, client.connects);
+    
+    virtualDelay(45000);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.retryLastWrite());
+    assertEqual(3, client.connects);
+    assertTrue(requestContains("\r\n\r\nfield1=2&"));
+    ThingSpeak.setRateLimit(0);
+  }
+  
+  /* This test case checks for the following:
+      - a value that passed the deadband is sent, and counts as sent once retryLastWrite() wrote it
+      - writeFields() returns 304 without a request if all values were suppressed
+      - a percent-only deadband suppresses a value that stays at 0
+  */
+  test(deadbandCase)
+  {
+    startTest(goodLAN);
+    client.responses[client.responseCount++] = writeResponse;
+    client.responses[client.responseCount++] = writeResponse;
+    client.responses[client.responseCount++] = writeResponse;
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldDeadband(1, 1, 0, 0));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldIfChanged(1, 10));
+    client.failConnects = 1;
+    assertEqual(TS_ERR_CONNECT_FAILED, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.retryLastWrite());
+    assertTrue(requestContains("\r\n\r\nfield1=10.00000&"));
+    
+    assertEqual(TS_OK_NOT_MODIFIED, ThingSpeak.setFieldIfChanged(1, 10.5));
+    assertEqual(TS_OK_NOT_MODIFIED, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertEqual(1, client.requests);
+    
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldIfChanged(1, 11));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldDeadband(2, 0, 10, 0));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldIfChanged(2, 0));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertTrue(requestContains("\r\n\r\nfield1=11.00000&field2=0.00000&"));
+    
+    assertEqual(TS_OK_NOT_MODIFIED, ThingSpeak.setFieldIfChanged(2, 0));
+    assertEqual(TS_OK_NOT_MODIFIED, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertEqual(2, client.requests);
+    
+    ThingSpeak.setFieldDeadband(1, 0, 0, 0);
+    ThingSpeak.setFieldDeadband(2, 0, 0, 0);
+  }
+  
+  /* This test case checks for the following:
+      - a buffer too small for a sample is rejected
+      - a queue channel without a write API key is rejected
+      - a sample older than the last queued one is rejected, since timestamps are stored as deltas
+      - queued samples are sent in one bulk update, with their timestamps and the field scales applied
+      - the samples are dropped from the queue once ThingSpeak accepted them
+  */
+  test(sampleQueueCase)
+  {
+    static uint8_t queueBuffer[128];
+    startTest(goodLAN);
+    assertEqual(TS_ERR_OUT_OF_RANGE, ThingSpeak.setSampleQueue(queueBuffer, 4));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setSampleQueue(queueBuffer, sizeof(queueBuffer)));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setQueueFieldScale(1, 0.1));
+    assertEqual(TS_ERR_OUT_OF_RANGE, ThingSpeak.setQueueChannel(TS_PRIORITY_ALARM, testChannelNumber, NULL));
+    assertEqual(TS_ERR_OUT_OF_RANGE, ThingSpeak.setQueueChannel(TS_PRIORITY_ALARM, testChannelNumber, ""));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setQueueChannel(TS_PRIORITY_ALARM, 0, NULL));
+    
+    ThingSpeak.setField(1, 21.5f);
+    ThingSpeak.setField(2, 3);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.queueFields(1792404000UL)); // 2026-10-19T10:00:00Z
+    ThingSpeak.setField(1, 22.0f);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.queueFields(1792404060UL));
+    ThingSpeak.setField(1, 20.0f);
+    assertEqual(TS_ERR_OUT_OF_RANGE, ThingSpeak.queueFields(1792404030UL));
+    assertEqual(2, ThingSpeak.getQueuedCount());
+    
+    client.responses[client.responseCount++] = "HTTP/1.1 202 Accepted\r\nContent-Length: 0\r\n\r\n";
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeQueuedFields(testChannelNumber, testChannelWriteAPIKey));
+    assertTrue(requestStartsWith("POST /channels/1070863/bulk_update.csv HTTP/1.1\r\n"));
+    assertTrue(requestContains("\r\n\r\nwrite_api_key=UI7FSU4O8ZJ5BM8O&time_format=absolute&updates="
+                               "2026-10-19T10:00:00Z,21.5,3.00000,,,,,,,,,,%7C2026-10-19T10:01:00Z,22.0,,,,,,,,,,,"));
+    assertEqual(0, ThingSpeak.getQueuedCount());
+    assertEqual(TS_ERR_SETFIELD_NOT_CALLED, ThingSpeak.writeQueuedFields(testChannelNumber, testChannelWriteAPIKey));
+    
+    ThingSpeak.setQueueFieldScale(1, 0);
+    ThingSpeak.setSampleQueue(NULL, 0);
+  }
+  
+  unsigned long thingSpeakNow() { return ThingSpeak.now(); }
+  
+  /* This test case checks for the following:
+      - the clock is set from the Date header, but writeFields() adds no created_at without a time source
+      - with a time source that returns now(), updates carry the synchronized time
+  */
+  test(clockTimestampCase)
+  {
+    startTest(goodLAN);
+    client.responses[client.responseCount++] = "HTTP/1.1 200 OK\r\nDate: Mon, 19 Oct 2026 10:00:00 GMT\r\nContent-Length: 2\r\n\r\n12";
+    client.responses[client.responseCount++] = writeResponse;
+    client.responses[client.responseCount++] = writeResponse;
+    ThingSpeak.setField(1, 1);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertEqual(1792404000UL, ThingSpeak.now());
+    
+    ThingSpeak.setField(1, 2);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertTrue(requestContains("\r\n\r\nfield1=2&headers=false"));
+    
+    ThingSpeak.setTimeSource(thingSpeakNow);
+    ThingSpeak.setField(1, 3);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertTrue(requestContains("\r\n\r\nfield1=3&created_at=2026-10-19T10:00:00Z&headers=false"));
+    ThingSpeak.setTimeSource(NULL);
+  }
+  
+  /* This test case checks for the following:
+      - a write that comes sooner than the rate limit returns -401 without a request
+      - its fields are kept, and coalesced with later ones into the next write
+      - that write reuses the kept-alive connection
+  */
+  test(rateLimitCase)
+  {
+    startTest(lossyWiFi);
+    ThingSpeak.setKeepAlive(30000);
+    ThingSpeak.setRateLimit(15000);
+    virtualDelay(15000); // let the writes of earlier tests age out
+    ThingSpeak.resetConnectionStats();
+    client.responses[client.responseCount++] = writeResponse;
+    client.responses[client.responseCount++] = writeResponse;
+    ThingSpeak.setField(1, 1);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    
+    ThingSpeak.setField(2, 2);
+    assertEqual(TS_ERR_NOT_INSERTED, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertEqual(1, client.requests);
+    assertNotEqual(0UL, ThingSpeak.getRateLimitDelay(testChannelNumber));
+    
+    ThingSpeak.setField(1, 3);
+    virtualDelay(ThingSpeak.getRateLimitDelay(testChannelNumber));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertTrue(requestStartsWith("POST /update HTTP/1.1\r\n"));
+    assertTrue(requestContains("\r\n\r\nfield1=3&field2=2&"));
+    assertEqual(1, client.connects);
+    assertEqual(1UL, ThingSpeak.getConnectionStats().keepAliveReused);
+    assertEqual(1UL, ThingSpeak.getConnectionStats().rateLimited);
+    
+    ThingSpeak.setRateLimit(0);
+    ThingSpeak.setKeepAlive(0);
+  }
+  
+  feedRow feedRows[2];
+  int feedRowCount = 0;
+  
+  void storeFeedRow(const feedRow & row)
+  {
+    if(feedRowCount < 2) feedRows[feedRowCount] = row;
+    feedRowCount++;
+  }
+  
+  /* This test case checks for the following:
+      - readFeedRange() requests feeds.csv for the time range
+      - a chunked response with a row split across chunks is read row by row
+      - empty and text fields are NaN
+      - HTTP errors are returned negated
+  */
+  test(readFeedRangeCase)
+  {
+    startTest(goodLAN);
+    feedRowCount = 0;
+    client.responses[client.responseCount++] = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                               "45\r\ncreated_at,entry_id,field1,field2\n2026-10-19 10:00:00 UTC,12,3.14,-47\r\n"
+                                               "21\r\n\n2026-10-19 10:00:15 UTC,13,,abc\n\r\n"
+                                               "0\r\n\r\n";
+    client.responses[client.responseCount++] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    assertEqual(2, ThingSpeak.readFeedRange(testChannelNumber, 1792404000UL, 1792407600UL, storeFeedRow, testChannelReadAPIKey));
+    assertTrue(requestStartsWith("GET /channels/1070863/feeds.csv?start=2026-10-19%2010:00:00&end=2026-10-19%2011:00:00&results=8000&timezone=UTC HTTP/1.1\r\n"));
+    assertEqual(2, feedRowCount);
+    assertEqual(1792404000UL, feedRows[0].createdAt);
+    assertEqual(12, feedRows[0].entryID);
+    assertEqual(3.14f, feedRows[0].field[0]);
+    assertEqual(-47.0f, feedRows[0].field[1]);
+    assertEqual(1792404015UL, feedRows[1].createdAt);
+    assertEqual(13, feedRows[1].entryID);
+    assertTrue(isnan(feedRows[1].field[0]));
+    assertTrue(isnan(feedRows[1].field[1]));
+    
+    assertEqual(-404, ThingSpeak.readFeedRange(testChannelNumber, 1792404000UL, 1792407600UL, storeFeedRow, testChannelReadAPIKey));
+    assertEqual(2, feedRowCount);
+  }
+  
+  /* This test case checks for the following:
+      - a buffer too small for the template is rejected
+      - fields that are not part of the template, and values that don't fit its width, are rejected
+      - writeTemplate() sends the patched values, zero-padded, with the Content-Length of the template
+      - a negative value that rounds to 0 is sent as 0
+  */
+  test(writeTemplateCase)
+  {
+    static char templateBuffer[256];
+    startTest(goodLAN);
+    assertEqual(TS_ERR_OUT_OF_RANGE, ThingSpeak.setWriteTemplate(templateBuffer, 64, testChannelNumber, testChannelWriteAPIKey, 0x05, 7, 2));
+    assertEqual(TS_ERR_SETFIELD_NOT_CALLED, ThingSpeak.writeTemplate());
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setWriteTemplate(templateBuffer, sizeof(templateBuffer), testChannelNumber, testChannelWriteAPIKey, 0x05, 7, 2));
+    assertEqual(TS_ERR_INVALID_FIELD_NUM, ThingSpeak.setTemplateField(2, 1));
+    assertEqual(TS_ERR_OUT_OF_RANGE, ThingSpeak.setTemplateField(1, 10000));
+    
+    client.responses[client.responseCount++] = writeResponse;
+    client.responses[client.responseCount++] = writeResponse;
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setTemplateField(1, 23.5));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setTemplateField(3, -0.001));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeTemplate());
+    assertTrue(requestStartsWith("POST /update HTTP/1.1\r\n"));
+    assertTrue(requestContains("X-THINGSPEAKAPIKEY: UI7FSU4O8ZJ5BM8O\r\n"));
+    assertTrue(requestContains("Content-Length: 43\r\n\r\nfield1=0023.50&field3=0000.00&headers=false"));
+    
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setTemplateField(3, -12.25));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeTemplate());
+    assertTrue(requestContains("Content-Length: 43\r\n\r\nfield1=0023.50&field3=-012.25&headers=false"));
+  }
+  
+  /* This test case checks for the following:
+      - with keep-alive, consecutive requests share one connection
+      - the second request doesn't pay the connect time again
+  */
+  test(keepAliveCase)
+  {
+    startTest(cellular2G);
+    ThingSpeak.setKeepAlive(30000);
+    unsigned long first = timeReadRaw();
+    unsigned long second = timeReadRaw();
+    assertEqual(1, client.connects);
+    assertEqual(2, client.requests);
+    assertLessOrEqual(second + cellular2G.connectMs, first);
+    ThingSpeak.setKeepAlive(0);
+  }
+  
+  /* This test case checks for the following:
+      - a read that finds the kept connection closed by the server is sent again on a new connection
+      - so is a write, which succeeds instead of failing
+  */
+  test(staleConnectionCase)
+  {
+    startTest(goodLAN);
+    ThingSpeak.setKeepAlive(30000);
+    ThingSpeak.resetConnectionStats();
+    client.closeIdle = true;
+    assertNotEqual(ULONG_MAX, timeReadRaw());
+    assertNotEqual(ULONG_MAX, timeReadRaw());
+    assertNotEqual(ULONG_MAX, timeWriteFields());
+    assertEqual(3, client.connects);
+    assertEqual(3, client.requests);
+    assertEqual(2UL, ThingSpeak.getConnectionStats().staleResent);
+    ThingSpeak.setKeepAlive(0);
+  }
+#endif // Mega and MKR1000 only tests
+
+void setup()
+{
+  Serial.begin(9600);
+  while(!Serial); // for the Arduino Leonardo/Micro only
+  Serial.println("Starting test...");
+}
+
+void loop()
+{
+  Test::run();
+}
@@ -22,6 +22,11 @@
 //#define USE_WIFI101_SHIELD
 //#define USE_ETHERNET_SHIELD
 
+// Uncomment to run the tests against extras/standin/thingspeak_standin.py instead of api.thingspeak.com, with the
+// address of the computer that runs it
+//#define THINGSPEAK_URL "192.168.1.10"
+//#define THINGSPEAK_PORT_NUMBER 8080
+
 #if !defined(USE_WIFI101_SHIELD) && !defined(USE_ETHERNET_SHIELD) && !defined(ARDUINO_SAMD_MKR1000) && !defined(ARDUINO_AVR_YUN)
   #error "Uncomment the #define for either USE_WIFI101_SHIELD or USE_ETHERNET_SHIELD"
 #endif
@@ -269,6 +274,34 @@ test(ReadStringFieldCase)
   assertEqual(TS_OK_SUCCESS,ThingSpeak.getLastReadStatus());
 }
 
+test(ReadStringFieldBufferCase) 
+{
+  // Always wait 15 seconds to ensure that rate limit isn't hit
+  delay(WRITE_DELAY_FOR_THINGSPEAK);
+  
+  ThingSpeak.setField(1,(float)3.14159);  // float
+  ThingSpeak.setField(5,"foobar"); // string
+  assertEqual(TS_OK_SUCCESS,ThingSpeak.writeFields(testPrivateChannelNumber, testPrivateChannelWriteAPIKey)); // string
+
+  char buf[16];
+  assertEqual(7,ThingSpeak.readStringField(testPrivateChannelNumber, 1, buf, sizeof(buf), testPrivateChannelReadAPIKey));
+  assertEqual(String("3.14159"),String(buf));
+  assertEqual(TS_OK_SUCCESS,ThingSpeak.getLastReadStatus());
+  assertEqual(6,ThingSpeak.readStringField(testPrivateChannelNumber, 5, buf, sizeof(buf), testPrivateChannelReadAPIKey));
+  assertEqual(String("foobar"),String(buf));
+  assertEqual(TS_OK_SUCCESS,ThingSpeak.getLastReadStatus());
+  
+  // Value does not fit -- truncated and out of range
+  char smallBuf[4];
+  assertEqual(TS_ERR_OUT_OF_RANGE,ThingSpeak.readStringField(testPrivateChannelNumber, 5, smallBuf, sizeof(smallBuf), testPrivateChannelReadAPIKey));
+  assertEqual(String("foo"),String(smallBuf));
+  assertEqual(TS_ERR_OUT_OF_RANGE,ThingSpeak.getLastReadStatus());
+  
+  // Test read of field out of range
+  assertEqual(TS_ERR_INVALID_FIELD_NUM,ThingSpeak.readStringField(testPrivateChannelNumber, 9, buf, sizeof(buf), testPrivateChannelReadAPIKey));
+  assertEqual(TS_ERR_INVALID_FIELD_NUM,ThingSpeak.getLastReadStatus());
+}
+
 test(readStatusPublicCase)
 {
   // Always wait 15 seconds to ensure that rate limit isn't hit
@@ -22,6 +22,11 @@
 //#define USE_WIFI101_SHIELD
 //#define USE_ETHERNET_SHIELD
 
+// Uncomment to run the tests against extras/standin/thingspeak_standin.py instead of api.thingspeak.com, with the
+// address of the computer that runs it
+//#define THINGSPEAK_URL "192.168.1.10"
+//#define THINGSPEAK_PORT_NUMBER 8080
+
 #if !defined(USE_WIFI101_SHIELD) && !defined(USE_ETHERNET_SHIELD) && !defined(ARDUINO_SAMD_MKR1000) && !defined(ARDUINO_AVR_YUN)
   #error "Uncomment the #define for either USE_WIFI101_SHIELD or USE_ETHERNET_SHIELD"
 #endif
@@ -308,6 +313,86 @@ test(setFieldCase)
     
     assertEqual(TS_OK_SUCCESS,ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
   }
+
+  /* This test case checks for the following:
+      - invalid field and threshold
+      - a value is staged the first time, and suppressed while it stays within the deadband
+      - a percent-only deadband suppresses a value that stays at 0
+      - writeFields returns 304 without a request if all values were suppressed
+  */
+  test(setFieldIfChangedCase)
+  {
+    // Always wait to ensure that rate limit isn't hit
+    delay(WRITE_DELAY_FOR_THINGSPEAK);
+
+    // Test invalid field and threshold
+    assertEqual(TS_ERR_INVALID_FIELD_NUM, ThingSpeak.setFieldDeadband(FIELD9, 1, 0, 0));
+    assertEqual(TS_ERR_OUT_OF_RANGE, ThingSpeak.setFieldDeadband(FIELD1, -1, 0, 0));
+
+    // Test a field that stays at 0
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldDeadband(FIELD1, 0, 10, 0));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldIfChanged(FIELD1, 0));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertEqual(TS_OK_NOT_MODIFIED, ThingSpeak.setFieldIfChanged(FIELD1, 0));
+    assertEqual(TS_OK_NOT_MODIFIED, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+
+    // Test the percent threshold
+    delay(WRITE_DELAY_FOR_THINGSPEAK);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldIfChanged(FIELD1, 5));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertEqual(TS_OK_NOT_MODIFIED, ThingSpeak.setFieldIfChanged(FIELD1, 5.4));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldIfChanged(FIELD1, 5.5));
+
+    delay(WRITE_DELAY_FOR_THINGSPEAK);
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldDeadband(FIELD1, 0, 0, 0));
+  }
+
+  /* This test case checks for the following:
+      - flush without samples
+      - invalid field, series and statistic
+      - mean, max, min and standard deviation of a window
+      - reset of the window after flush
+  */
+  test(setFieldAggregateCase)
+  {
+    float samples[] = {2, 4, 4, 4, 5, 5, 7, 9};
+    // Always wait to ensure that rate limit isn't hit
+    delay(WRITE_DELAY_FOR_THINGSPEAK);
+
+    assertEqual(TS_OK_NOT_MODIFIED, ThingSpeak.flushAggregates());
+
+    // Test invalid mappings and samples
+    assertEqual(TS_ERR_INVALID_FIELD_NUM, ThingSpeak.setFieldAggregate(FIELD9, 1, TS_AGGREGATE_MEAN));
+    assertEqual(TS_ERR_OUT_OF_RANGE, ThingSpeak.setFieldAggregate(FIELD1, 0, TS_AGGREGATE_MEAN));
+    assertEqual(TS_ERR_OUT_OF_RANGE, ThingSpeak.setFieldAggregate(FIELD1, 1, TS_AGGREGATE_STDDEV + 1));
+    assertEqual(TS_ERR_OUT_OF_RANGE, ThingSpeak.addSample(1, NAN));
+
+    // Test statistics of a window
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldAggregate(FIELD1, 1, TS_AGGREGATE_MEAN));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldAggregate(FIELD2, 1, TS_AGGREGATE_MAX));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldAggregate(FIELD3, 1, TS_AGGREGATE_MIN));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldAggregate(FIELD4, 1, TS_AGGREGATE_STDDEV));
+    for(unsigned int i = 0; i < sizeof(samples) / sizeof(samples[0]); i++)
+    {
+      assertEqual(TS_OK_SUCCESS, ThingSpeak.addSample(1, samples[i]));
+    }
+    assertEqual(8, ThingSpeak.getAggregate(1).count);
+    assertEqual(5, ThingSpeak.getAggregate(1).mean);
+    assertEqual(9, ThingSpeak.getAggregate(1).max);
+    assertEqual(2, ThingSpeak.getAggregate(1).min);
+    // Sample standard deviation, as flushAggregates() sets it for field 4
+    assertLess(abs(sqrt(ThingSpeak.getAggregate(1).m2 / (ThingSpeak.getAggregate(1).count - 1)) - 2.138), float(0.001));
+    assertEqual(TS_OK_SUCCESS, ThingSpeak.flushAggregates());
+    assertEqual(0, ThingSpeak.getAggregate(1).count);
+
+    assertEqual(TS_OK_SUCCESS,ThingSpeak.writeFields(testChannelNumber, testChannelWriteAPIKey));
+    
+    for(unsigned int field = FIELD1; field <= FIELD4; field++)
+    {
+      assertEqual(TS_OK_SUCCESS, ThingSpeak.setFieldAggregate(field, 1, TS_AGGREGATE_NONE));
+    }
+  }
 #endif // Mega and MKR1000 only tests
 
 void setup()
@@ -22,10 +22,35 @@
 
     #include "Arduino.h"
     #include <Client.h>
+    #include <limits.h>
+    #if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_SAM)
+        extern "C" char * sbrk(int increment);
+    #elif defined(ARDUINO_ARCH_AVR)
+        extern char * __brkval;
+        extern char __heap_start;
+    #endif
+
+    // Define these before including ThingSpeak.h to build against another server, e.g. a local stand-in for offline testing
+    #ifndef THINGSPEAK_URL
+        #define THINGSPEAK_URL "api.thingspeak.com"
+    #endif
+    #ifndef THINGSPEAK_PORT_NUMBER
+        #define THINGSPEAK_PORT_NUMBER 80
+    #endif
+    #ifndef THINGSPEAK_HTTPS_PORT_NUMBER
+        #define THINGSPEAK_HTTPS_PORT_NUMBER 443
+    #endif
+
+    // Clock used for all timeouts, intervals and backoffs.  Define these before including ThingSpeak.h to drive the library from a virtual clock, e.g. in tests with a mock client.
+    #ifndef TS_MILLIS
+        #define TS_MILLIS() millis()
+    #endif
+    #ifndef TS_DELAY
+        #define TS_DELAY(ms) delay(ms)
+    #endif
 
-    #define THINGSPEAK_URL "api.thingspeak.com"
-    #define THINGSPEAK_PORT_NUMBER 80
-    #define THINGSPEAK_HTTPS_PORT_NUMBER 443
+    #define TS_DNS_CACHE_TTL_MS 3600000UL       // Default time a resolved server address is reused (one hour)
+    #define TS_DNS_CACHE_MAX_CONNECT_FAILURES 2 // Resolve the server again after this many failed connects in a row
 
     #ifdef ARDUINO_ARCH_AVR
         #ifdef ARDUINO_AVR_YUN
@@ -61,9 +86,62 @@
     #define FIELDNUM_MAX 8
     #define FIELDLENGTH_MAX 255  // Max length for a field in ThingSpeak is 255 bytes (UTF-8)
 
+    #define TS_NUMBER_LENGTH_MAX 31  // Longest numeric value read by readFloatField(), readLongField() and readIntField(); longer values are an error (-101)
+
+    #ifndef TS_POLL_CHANNELS_MAX
+        #define TS_POLL_CHANNELS_MAX 4  // Number of channels pollChannel() tracks at once
+    #endif
+    #define TS_POLL_INTERVAL_MS_MIN 15000       // Default shortest interval between polls of a channel
+    #define TS_POLL_INTERVAL_MS_MAX 300000      // Default longest interval between polls of a channel
+
+    #ifndef TS_AGGREGATE_SERIES_MAX
+        #define TS_AGGREGATE_SERIES_MAX 8  // Number of sample series addSample() aggregates at once
+    #endif
+    #define TS_AGGREGATE_NONE 0     // Field is not written by flushAggregates()
+    #define TS_AGGREGATE_LAST 1     // Latest sample of the window
+    #define TS_AGGREGATE_MIN 2      // Smallest sample of the window
+    #define TS_AGGREGATE_MAX 3      // Largest sample of the window
+    #define TS_AGGREGATE_MEAN 4     // Mean of the samples of the window
+    #define TS_AGGREGATE_COUNT 5    // Number of samples in the window
+    #define TS_AGGREGATE_STDDEV 6   // Sample standard deviation of the window (not available with TS_AGGREGATE_NO_VARIANCE)
+
+    #define TS_CIRCUIT_CLOSED 0     // Connects are attempted normally
+    #define TS_CIRCUIT_OPEN 1       // Connects fail fast with TS_ERR_CIRCUIT_OPEN until the backoff elapsed
+    #define TS_CIRCUIT_HALF_OPEN 2  // The next connect probes whether the uplink is back
+
+    #define TS_PREPARE_LEAD_MS 3000             // Default time before a scheduled write at which prepare() connects
+    #define TS_PREPARED_MAX_IDLE_MS 10000       // A prepared connection left unused longer than this is considered stale
+
+    #ifndef TS_RATE_LIMIT_CHANNELS_MAX
+        #define TS_RATE_LIMIT_CHANNELS_MAX 4    // Number of channels setRateLimit() tracks the last write of
+    #endif
+
+    #define TS_SAMPLE_QUEUE_MAGIC 0x5451        // Marks a buffer that holds a sample queue, so that a queue in RTC memory survives a deep sleep
+    #define TS_SAMPLE_RECORD_MAX (1 + 5 + 2 * FIELDNUM_MAX)  // Presence bitmap, varint time delta and 16 bit values of a queued sample
+    #define TS_FLOAT16_MAX 65504                // Largest magnitude of a value queued as float16
+    #define TS_BULK_UPDATE_MAX 960              // Most queued samples sent in one bulk update
+    #define TS_PRIORITY_ROUTINE 0               // Priority of routine telemetry in the sample queue
+    #define TS_PRIORITY_ALARM 1                 // Priority of alarms, written before any routine samples
+    #ifndef TS_PRIORITY_LEVELS
+        #define TS_PRIORITY_LEVELS 2            // Number of sample queue priorities; higher numbers are written first
+    #endif
+
+    #define TS_HEADER_LINE_MAX 48               // Longest response header line parsed; Content-Length and Date fit, the rest of longer lines is skipped
+    #define TS_CLOCK_STEP_MS 60000              // A server time this far from now() sets the clock instead of slewing it
+    #define TS_CLOCK_DRIFT_WINDOW_MS 3600000UL  // Clock corrections are averaged over at least this long to estimate the drift of millis()
+    #define TS_CLOCK_DRIFT_PPM_MAX 20000        // Largest drift of millis() that is corrected
+    #define TS_ISO8601_LENGTH 21                // Buffer size for formatISO8601(), including the terminator
+    #define TS_FEED_RESULTS_MAX 8000            // Most entries ThingSpeak returns for one feed request
+    #define TS_CSV_CELL_MAX 32                  // Longest CSV cell parsed by readFeedRange(); the rest of longer cells is skipped
+    #define TS_CSV_COLUMNS_MAX 16               // Most CSV columns mapped by readFeedRange()
+    #define TS_CSV_COLUMN_OTHER 0               // CSV column that readFeedRange() doesn't pass on; 1-8 are the fields
+    #define TS_CSV_COLUMN_CREATED_AT 9
+    #define TS_CSV_COLUMN_ENTRY_ID 10
+
     #define TIMEOUT_MS_SERVERRESPONSE 5000  // Wait up to five seconds for server to respond
 
     #define TS_OK_SUCCESS              200     // OK / Success
+    #define TS_OK_NOT_MODIFIED         304     // Nothing to do: polled channel has no new entry, poll, prepare() or queued batch is not due yet, the deadband filter suppressed all values, or no samples to aggregate
     #define TS_ERR_BADAPIKEY           400     // Incorrect API key (or invalid ThingSpeak server address)
     #define TS_ERR_BADURL              404     // Incorrect API key (or invalid ThingSpeak server address)
     #define TS_ERR_OUT_OF_RANGE        -101    // Value is out of range or string is too long (> 255 bytes)
@@ -73,6 +151,7 @@
     #define TS_ERR_UNEXPECTED_FAIL     -302    // Unexpected failure during write to ThingSpeak
     #define TS_ERR_BAD_RESPONSE        -303    // Unable to parse response
     #define TS_ERR_TIMEOUT             -304    // Timeout waiting for server to respond
+    #define TS_ERR_CIRCUIT_OPEN        -305    // Connect skipped after repeated connect failures (see setCircuitBreaker())
     #define TS_ERR_NOT_INSERTED        -401    // Point was not inserted (most probable cause is the rate limit of once every 15 seconds)
 
     
@@ -87,6 +166,270 @@
             String nextReadElevation;
             String nextReadCreatedAt;
         }feed;
+        
+        // entry passed to the callback of readFeedRange
+        typedef struct feedRowRecord
+        {
+            unsigned long createdAt;        // Seconds since 1970-01-01 UTC
+            long entryID;
+            float field[FIELDNUM_MAX];      // NAN if the field is empty or not numeric
+        }feedRow;
+        
+        // per-field state of the deadband filter (setFieldDeadband)
+        typedef struct deadbandRecord
+        {
+            float absoluteThreshold;
+            float percentThreshold;
+            unsigned long maxSilence;
+            float lastSent;
+            unsigned long lastSentTime;
+            float pending;                  // Staged by setFieldIfChanged()
+            float writing;                  // In the update of writeFields() until it is written, possibly by retryLastWrite()
+            bool sent;
+        }deadband;
+        
+        // counters reported by getDeadbandStats()
+        typedef struct deadbandStatistics
+        {
+            unsigned long staged;           // Values staged by setFieldIfChanged()
+            unsigned long suppressed;       // Values suppressed by setFieldIfChanged()
+            unsigned long writesSkipped;    // Calls to writeFields() that sent nothing because all values were suppressed
+        }deadbandStats;
+        
+        // running statistics of a sample series over the current window (addSample)
+        typedef struct aggregateRecord
+        {
+            unsigned long count;
+            float last;
+            float min;
+            float max;
+            float mean;
+            #ifndef TS_AGGREGATE_NO_VARIANCE
+                float m2;       // Sum of squared differences from the mean (Welford)
+            #endif
+        }aggregate;
+        
+        // state of the sample queue (setSampleQueue), kept at the start of the caller's buffer
+        typedef struct sampleQueueHeader
+        {
+            uint16_t magic;
+            uint16_t capacity;      // Bytes available for records
+            uint16_t head;          // Offset of the oldest record
+            uint16_t used;          // Bytes of queued records
+            uint16_t count;         // Queued samples
+            uint16_t dropped;       // Oldest samples overwritten because the queue was full, up to 65535
+            uint32_t headTime;      // Timestamp of the oldest sample
+            uint32_t tailTime;      // Timestamp of the newest sample
+            float scale[FIELDNUM_MAX];  // Resolution of the fixed point values of a field, 0 to queue it as float16
+        }sampleQueue;
+        
+        // sample queue of one priority: the caller's buffer, a copy of its header, and how it's written
+        typedef struct priorityQueueRecord
+        {
+            uint8_t * buffer;
+            sampleQueue header;
+            unsigned long channelNumber;    // 0 to write to the channel passed to writeQueuedFields()
+            const char * writeAPIKey;
+            unsigned int batchMin;          // Samples to collect before a bulk update
+            unsigned long batchMaxAge;      // Seconds the oldest sample may wait for the batch to fill, 0 for no limit
+        }priorityQueue;
+        
+        // per-channel state of the pollChannel functionality
+        typedef struct pollRecord
+        {
+            unsigned long channelNumber;
+            bool polled;
+            long lastEntryID;
+            unsigned long lastPollTime;
+            unsigned long lastChangeTime;
+            unsigned long cadence;
+            unsigned long interval;
+        }pollState;
+        
+        // last write to a channel, for the rate limit set with setRateLimit()
+        typedef struct rateLimitRecord
+        {
+            unsigned long channelNumber;
+            bool written;
+            unsigned long lastWriteTime;
+        }rateLimit;
+    #endif
+
+
+    // Trace events recorded when TS_TRACE is defined, see dumpTrace()
+    #define TS_TRACE_CONNECT 1          // a: connect time in ms, b: 1 if connected
+    #define TS_TRACE_REUSE 2            // a: 1 kept-alive connection, 2 prepared connection
+    #define TS_TRACE_REQUEST 3          // a: channel number, b: bytes of the update body, 0 for reads
+    #define TS_TRACE_RESPONSE 4         // a: HTTP status or error code, b: Content-Length
+    #define TS_TRACE_TIMEOUT 5          // a: bytes available, b: bytes expected
+    #define TS_TRACE_RETRY 6            // a: attempt, b: status of the failed attempt
+    #define TS_TRACE_RELEASE 7          // a: 1 if the connection was kept open
+    #ifdef TS_TRACE
+        #ifndef TS_TRACE_EVENTS
+            #define TS_TRACE_EVENTS 32  // Events kept; older ones are overwritten
+        #endif
+        #define TS_TRACE_EVENT(id, a, b) traceEvent(id, a, b)
+        
+        // event recorded by TS_TRACE_EVENT
+        typedef struct traceEventRecord
+        {
+            uint32_t time;      // micros() when the event was recorded
+            uint8_t id;
+            int32_t a;
+            int32_t b;
+        }traceEntry;
+    #else
+        #define TS_TRACE_EVENT(id, a, b)
+    #endif
+    
+    #ifdef TS_MEMORY_STATS
+        #define TS_MEMORY_WRITE_FIELDS 0        // writeField() and writeFields()
+        #define TS_MEMORY_WRITE_RAW 1           // writeRaw()
+        #define TS_MEMORY_READ_RAW 2            // readRaw() and the read...Field(), readStatus() and readCreatedAt() functions
+        #define TS_MEMORY_READ_MULTIPLE 3       // readMultipleFields()
+        #define TS_MEMORY_CALLS 4
+        
+        // memory use of a public call, reported by getMemoryStats()
+        typedef struct memoryStatisticsRecord
+        {
+            unsigned long calls;    // Calls measured
+            long peakUse;           // Most memory taken during a call beyond what was in use when it started, in bytes; on AVR this includes the stack
+            long freeMin;           // Least free memory seen during a call, in bytes; 0 where getFreeMemory() isn't supported
+            size_t stackPeak;       // Deepest stack below the frame of the call, in bytes
+        }memoryStats;
+    #endif
+    
+    #ifndef ARDUINO_AVR_UNO
+        #define TS_TEMPLATE_WIDTH_MAX 15   // Widest value slot of a request template
+        
+        // request rendered by setWriteTemplate(), with the position of each value
+        typedef struct requestTemplateRecord
+        {
+            char * buffer;
+            size_t length;                  // Bytes of the request, 0 if there is no template
+            unsigned long channelNumber;
+            uint16_t slot[FIELDNUM_MAX];    // Offset of the value of each field, 0 if the field isn't in the template
+            uint8_t width;
+            uint8_t decimals;
+            float scale;                    // 10 to the power of decimals
+        }requestTemplate;
+    #endif
+    
+    // position of a "key":value pair found by nextJSONMember(); string values exclude their quotes
+    typedef struct jsonMemberRecord
+    {
+        size_t keyStart;
+        size_t keyLength;
+        size_t valueStart;
+        size_t valueLength;
+        bool string;
+    }jsonMember;
+
+
+    #ifndef ARDUINO_AVR_UNO
+        #define TS_STATS_ADD(counter, value) this->stats.counter += (value)
+        
+        // counters reported by getConnectionStats()
+        typedef struct connectionStatistics
+        {
+            unsigned long connects;         // Connections opened
+            unsigned long connectFailures;  // Connections that failed to open
+            unsigned long connectTimeMs;    // Total time spent opening connections
+            unsigned long preparedUsed;     // Requests that found a connection opened by prepare()
+            unsigned long preparedStale;    // Connections opened by prepare() that were dropped as stale
+            unsigned long latencySavedMs;   // Connect time moved out of requests by prepare()
+            unsigned long fullHandshakes;           // HTTPS connections opened without a session to resume
+            unsigned long fullHandshakeTimeMs;      // Total connect time of those connections
+            unsigned long resumedHandshakes;        // HTTPS connections opened offering a cached session
+            unsigned long resumedHandshakeTimeMs;   // Total connect time of those connections
+            unsigned long circuitOpened;    // Times the circuit breaker opened
+            unsigned long circuitRejected;  // Connects skipped while the circuit breaker was open
+            unsigned long keepAliveReused;  // Requests sent on a connection kept open by setKeepAlive()
+            unsigned long staleResent;      // Requests sent again after the kept or prepared connection turned out to be closed
+            unsigned long rateLimited;      // Writes held back by setRateLimit() without a request
+        }connectionStats;
+    #else
+        #define TS_STATS_ADD(counter, value)
+    #endif
+
+
+    #ifndef ARDUINO_AVR_UNO
+        // Adapter that lets HTTPS clients reuse a TLS session across connections, see setSessionCache()
+        class ThingSpeakSessionCache
+        {
+          public:
+            virtual ~ThingSpeakSessionCache() {}
+            
+            // Called right before the client connects.  Hand the cached session to the client, and return true if there is one to resume.
+            virtual bool beforeConnect() = 0;
+            
+            // Called after the connect attempt.  The client stores the negotiated session for the next connect.
+            virtual void afterConnect(bool connected) = 0;
+        };
+        
+        #if defined(wificlientbearssl_h)
+            // Session cache for the ESP8266 BearSSL::WiFiClientSecure client
+            class ThingSpeakBearSSLSession : public ThingSpeakSessionCache
+            {
+              public:
+                ThingSpeakBearSSLSession(BearSSL::WiFiClientSecure & client) : client(client) {}
+                
+                bool beforeConnect()
+                {
+                    this->client.setSession(&this->session);
+                    return this->hasSession;
+                }
+                
+                void afterConnect(bool connected)
+                {
+                    this->hasSession = connected;
+                }
+                
+              private:
+                BearSSL::WiFiClientSecure & client;
+                BearSSL::Session session;
+                bool hasSession = false;
+            };
+        #endif
+    #endif
+
+
+    // Print that only counts the bytes written to it, used to size a request body before sending it
+    class ThingSpeakByteCounter : public Print
+    {
+      public:
+        size_t count = 0;
+        
+        size_t write(uint8_t)
+        {
+            this->count++;
+            return 1;
+        }
+    };
+
+    #ifndef ARDUINO_AVR_UNO
+        // Print that renders into a caller's buffer, for setWriteTemplate()
+        class ThingSpeakBufferPrint : public Print
+        {
+          public:
+            char * buffer;
+            size_t size;
+            size_t length = 0;
+            bool overflow = false;
+            
+            ThingSpeakBufferPrint(char * buffer, size_t size) : buffer(buffer), size(size) {}
+            
+            size_t write(uint8_t c)
+            {
+                if(this->length >= this->size)
+                {
+                    this->overflow = true;
+                    return 0;
+                }
+                this->buffer[this->length++] = c;
+                return 1;
+            }
+        };
     #endif
 
 
@@ -120,17 +463,24 @@
         bool begin(Client & client)
         {
             #ifdef PRINT_DEBUG_MESSAGES
-                Serial.println("ts::tsBegin");
+                Serial.println(F("ts::tsBegin"));
             #endif
             
             this->setClient(&client);
             
+            this->server = THINGSPEAK_URL;
+            #ifndef ARDUINO_AVR_UNO
+                this->connectionKept = false;
+                this->serverResolved = false;
+            #endif
+            this->secureConnection = false;
             this->setPort(THINGSPEAK_PORT_NUMBER);
             #if defined(TS_ENABLE_SSL)
                 #if defined(WIFISSLCLIENT_H) || defined(wificlientbearssl_h) || defined(WiFiClientSecure_h)
+                    this->secureConnection = true;
                     this->setPort(THINGSPEAK_HTTPS_PORT_NUMBER);
                 #else
-                    Serial.println("WARNING: This library doesn't support SSL connection to ThingSpeak. Default HTTP Connection used.");
+                    Serial.println(F("WARNING: This library doesn't support SSL connection to ThingSpeak. Default HTTP Connection used."));
                 #endif
             #endif
     
@@ -140,6 +490,75 @@
         }
         
         
+        /*
+        Function: setServer
+        
+        Summary:
+        Direct all requests to another host and port, e.g. a local test server.
+        
+        Parameters:
+        host - Host name or dotted IP address of the server.  The string must remain valid while the library is used.
+        port - Port number of the server.
+        
+        Returns:
+        Code of 200 if successful.
+        Code of -101 if host is NULL or empty.
+        
+        Notes:
+        Call this after begin(), which restores api.thingspeak.com and the default port.
+        Whether the connection uses HTTPS is still determined by the client passed to begin().
+        */
+        int setServer(const char * host, unsigned int port)
+        {
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("ts::setServer(host: ")); Serial.print(host); Serial.print(F(" port: ")); Serial.print(port); Serial.println(F(")"));
+            #endif
+            if(NULL == host || '\0' == *host) return TS_ERR_OUT_OF_RANGE;
+            
+            this->server = host;
+            this->setPort(port);
+            #ifndef ARDUINO_AVR_UNO
+                this->serverResolved = false;
+                if(this->connectionKept)
+                {
+                    this->connectionKept = false;
+                    this->client->stop();
+                }
+            #endif
+            
+            return TS_OK_SUCCESS;
+        }
+        
+        
+        #ifndef ARDUINO_AVR_UNO
+            /*
+            Function: setHostResolver
+            
+            Summary:
+            Resolve the server name once and connect by IP address, instead of looking up the name before every request.
+            
+            Parameters:
+            resolver - Function that resolves a host name, returning 1 on success, e.g. a wrapper around WiFi.hostByName().  NULL disables the cache.
+            ttlMs - Time in milliseconds the resolved address is reused before it is resolved again.
+            
+            Returns:
+            Always returns 200
+            
+            Notes:
+            The address is also resolved again after repeated failed connects.
+            HTTPS connections always connect by host name, since the client needs it for SNI and certificate validation.
+            */
+            int setHostResolver(int (*resolver)(const char * host, IPAddress & address), unsigned long ttlMs)
+            {
+                this->hostResolver = resolver;
+                this->serverResolveTTL = ttlMs;
+                this->serverResolved = false;
+            
+                return TS_OK_SUCCESS;
+            }
+            
+        #endif
+        
         /*
         Function: writeField
         
@@ -212,7 +631,7 @@
         int writeField(unsigned long channelNumber, unsigned int field, float value, const char * writeAPIKey)
         {
             #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("ts::writeField (channelNumber: "); Serial.print(channelNumber); Serial.print(" writeAPIKey: "); Serial.print(writeAPIKey); Serial.print(" field: "); Serial.print(field); Serial.print(" value: "); Serial.print(value,5); Serial.println(")");
+                Serial.print(F("ts::writeField (channelNumber: ")); Serial.print(channelNumber); Serial.print(F(" writeAPIKey: ")); Serial.print(writeAPIKey); Serial.print(F(" field: ")); Serial.print(field); Serial.print(F(" value: ")); Serial.print(value,5); Serial.println(F(")"));
             #endif
             char valueString[20]; // range is -999999000000.00000 to 999999000000.00000, so 19 + 1 for the terminator
             int status = convertFloatToChar(value, valueString);
@@ -248,11 +667,11 @@
             if(value.length() > FIELDLENGTH_MAX) return TS_ERR_OUT_OF_RANGE;
             
             #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("ts::writeField (channelNumber: "); Serial.print(channelNumber); Serial.print(" writeAPIKey: "); Serial.print(writeAPIKey); Serial.print(" field: "); Serial.print(field); Serial.print(" value: \""); Serial.print(value); Serial.println("\")");
+                Serial.print(F("ts::writeField (channelNumber: ")); Serial.print(channelNumber); Serial.print(F(" writeAPIKey: ")); Serial.print(writeAPIKey); Serial.print(F(" field: ")); Serial.print(field); Serial.print(F(" value: \"")); Serial.print(value); Serial.println(F("\")"));
             #endif
-            String postMessage = String("field");
+            String postMessage = String(F("field"));
             postMessage.concat(field);
-            postMessage.concat("=");
+            postMessage.concat(F("="));
             postMessage.concat(value);
             
             return writeRaw(channelNumber, postMessage, writeAPIKey);
@@ -342,1194 +761,4408 @@
         Code of 200 if successful.
         Code of -101 if value is out of range or string is too long (> 255 bytes)
         */
-        int setField(unsigned int field, String value)
-        {
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("ts::setField   (field: "); Serial.print(field); Serial.print(" value: \""); Serial.print(value); Serial.println("\")");
-            #endif
-            if(field < FIELDNUM_MIN || field > FIELDNUM_MAX) return TS_ERR_INVALID_FIELD_NUM;
-            // Max # bytes for ThingSpeak field is 255 (UTF-8)
-            if(value.length() > FIELDLENGTH_MAX) return TS_ERR_OUT_OF_RANGE;
-            this->nextWriteField[field - 1] = value;
-            
-            return TS_OK_SUCCESS;
-        }
-
-         
-        /*
-        Function: setLatitude
-        
-        Summary:
-        Set the latitude of a multi-field update.
-        
-        Parameters:
-        latitude - Latitude of the measurement as a floating point value (degrees N, use negative values for degrees S)
-        
-        Returns:
-        Always return 200
-        
-        Notes:
-        To record latitude, longitude and elevation of a write, call setField() for each of the fields you want to write. Then setLatitude(), setLongitude(), setElevation() and then call writeFields()
-        */
-        int setLatitude(float latitude)
-        {
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("ts::setLatitude(latitude: "); Serial.print(latitude,3); Serial.println("\")");
-            #endif
-            this->nextWriteLatitude = latitude;
-            
-            return TS_OK_SUCCESS;
-        }
-
-     
-        /*
-        Function: setLongitude
-        
-        Summary:
-        Set the longitude of a multi-field update.
-        
-        Parameters:
-        longitude - Longitude of the measurement as a floating point value (degrees E, use negative values for degrees W)
-        
-        Returns:
-        Always return 200
-        
-        Notes:
-        To record latitude, longitude and elevation of a write, call setField() for each of the fields you want to write. Then setLatitude(), setLongitude(), setElevation() and then call writeFields()
-        */
-        int setLongitude(float longitude)
+        int setField(unsigned int field, const String & value)
         {
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("ts::setLongitude(longitude: "); Serial.print(longitude,3); Serial.println("\")");
-            #endif
-            this->nextWriteLongitude = longitude;
-            
-            return TS_OK_SUCCESS;
+            return setField(field, value.c_str());
         }
-
-         
-        /*
-        Function: setElevation
-        
-        Summary:
-        Set the elevation of a multi-field update.
-        
-        Parameters:
-        elevation - Elevation of the measurement as a floating point value (meters above sea level)
-        
-        Returns:
-        Always return 200
         
-        Notes:
-        To record latitude, longitude and elevation of a write, call setField() for each of the fields you want to write. Then setLatitude(), setLongitude(), setElevation() and then call writeFields()
         
-        */
-        int setElevation(float elevation)
-        {
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("ts::setElevation(elevation: "); Serial.print(elevation,3); Serial.println("\")");
-            #endif
-            this->nextWriteElevation = elevation;
-            
-            return TS_OK_SUCCESS;
-        }
-
-         
         /*
-        Function: setStatus
+        Function: setField
         
         Summary:
-        Set the status field of a multi-field update.
+        Set the value of a single field that will be part of a multi-field update.
         
         Parameters:
-        status - String to write (UTF8).  ThingSpeak limits this to 255 bytes.
+        field - Field number (1-8) within the channel to set.
+        value - Character array (zero terminated) to write (UTF8).  ThingSpeak limits this to 255 bytes.
         
         Returns:
         Code of 200 if successful.
-        Code of -101 if string is too long (> 255 bytes)
-        
-        Notes:
-        To record a status message on a write, call setStatus() then call writeFields().
-        Use status to provide additional details when writing a channel update.
+        Code of -101 if value is out of range or string is too long (> 255 bytes)
         */
-        int setStatus(String status)
+        int setField(unsigned int field, const char * value)
         {
             #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("ts::setStatus(status: "); Serial.print(status); Serial.println("\")");
+                Serial.print(F("ts::setField   (field: ")); Serial.print(field); Serial.print(F(" value: \"")); Serial.print(value); Serial.println(F("\")"));
             #endif
+            if(field < FIELDNUM_MIN || field > FIELDNUM_MAX) return TS_ERR_INVALID_FIELD_NUM;
+            if(NULL == value) value = "";
             // Max # bytes for ThingSpeak field is 255 (UTF-8)
-            if(status.length() > FIELDLENGTH_MAX) return TS_ERR_OUT_OF_RANGE;
-            this->nextWriteStatus = status;
+            if(strlen(value) > FIELDLENGTH_MAX) return TS_ERR_OUT_OF_RANGE;
+            // Assigning a character array reuses the buffer of the previous value, so setting numbers doesn't allocate once the fields have been written
+            this->nextWriteField[field - 1] = value;
             
             return TS_OK_SUCCESS;
         }
-        
 
-        /*
-        Function: setCreatedAt
-        
-        Summary:
-        Set the created-at date of a multi-field update.
-        
-        Parameters:
-        createdAt - Desired timestamp to be included with the channel update as a String.  The timestamp string must be in the ISO 8601 format. Example "2017-01-12 13:22:54"
         
-        Returns:
-        Code of 200 if successful.
-        Code of -101 if string is too long (> 255 bytes)
+        #ifndef ARDUINO_AVR_UNO // Arduino Uno doesn't have enough memory to perform the following functionalities.
         
-        Notes:
-        Timezones can be set using the timezone hour offset parameter. For example, a timestamp for Eastern Standard Time is: "2017-01-12 13:22:54-05".
-        If no timezone hour offset parameter is used, UTC time is assumed.
-        */
-        int setCreatedAt(String createdAt)
-        {
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("ts::setCreatedAt(createdAt: "); Serial.print(createdAt); Serial.println("\")");
-            #endif
+            /*
+            Function: setFieldDeadband
             
-            // the ISO 8601 format is too complicated to check for valid timestamps here
-            // we'll need to reply on the api to tell us if there is a problem
-            // Max # bytes for ThingSpeak field is 255 (UTF-8)
-            if(createdAt.length() > FIELDLENGTH_MAX) return TS_ERR_OUT_OF_RANGE;
-            this->nextWriteCreatedAt = createdAt;
+            Summary:
+            Configure the deadband filter of a field used by setFieldIfChanged().
             
-            return TS_OK_SUCCESS;
-        }
-        
-     
-        /*
-        Function: writeFields
-        
-        Summary:
-        Write a multi-field update.
-        
-        Parameters:
-        channelNumber - Channel number
-        writeAPIKey - Write API key associated with the channel.  *If you share code with others, do _not_ share this key*
-        
-        Returns:
-        200 - successful.
-        404 - Incorrect API key (or invalid ThingSpeak server address)
-        -101 - Value is out of range or string is too long (> 255 characters)
-        -201 - Invalid field number specified
-        -210 - setField() was not called before writeFields()
-        -301 - Failed to connect to ThingSpeak
-        -302 - Unexpected failure during write to ThingSpeak
-        -303 - Unable to parse response
-        -304 - Timeout waiting for server to respond
-        -401 - Point was not inserted (most probable cause is the rate limit of once every 15 seconds)
-        
-        Notes:
-        Call setField(), setLatitude(), setLongitude(), setElevation() and/or setStatus() and then call writeFields()
-        */
-        int writeFields(unsigned long channelNumber, const char * writeAPIKey)
-        {
-            if(!connectThingSpeak()){
-                // Failed to connect to ThingSpeak
-                return TS_ERR_CONNECT_FAILED;
-            }
+            Parameters:
+            field - Field number (1-8) within the channel.
+            absoluteThreshold - Smallest change from the last written value that is written again.  0 to not use an absolute threshold.
+            percentThreshold - Smallest change, in percent of the last written value, that is written again.  0 to not use a relative threshold.
+            maxSilenceMs - Write the value anyway if the field was not written for this many milliseconds (heartbeat).  0 to disable the heartbeat.
             
-            // Get the content length of the payload
-            int contentLen = getWriteFieldsContentLength();
+            Returns:
+            Code of 200 if successful.
+            Code of -201 if the field number is invalid.
+            Code of -101 if a threshold is negative.
             
-            if(contentLen == 0){
-                // setField was not called before writeFields
-                return TS_ERR_SETFIELD_NOT_CALLED;
+            Notes:
+            A value passes the filter if it moved by at least either threshold.  With both thresholds 0, any change passes.
+            This feature not available in Arduino Uno due to memory constraints.
+            */
+            int setFieldDeadband(unsigned int field, float absoluteThreshold, float percentThreshold, unsigned long maxSilenceMs)
+            {
+                if(field < FIELDNUM_MIN || field > FIELDNUM_MAX) return TS_ERR_INVALID_FIELD_NUM;
+                if(absoluteThreshold < 0 || percentThreshold < 0) return TS_ERR_OUT_OF_RANGE;
+                
+                deadband & filter = this->deadbands[field - 1];
+                filter.absoluteThreshold = absoluteThreshold;
+                filter.percentThreshold = percentThreshold;
+                filter.maxSilence = maxSilenceMs;
+                filter.sent = false;
+                
+                return TS_OK_SUCCESS;
             }
             
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("ts::writeFields   (channelNumber: "); Serial.print(channelNumber); Serial.print(" writeAPIKey: "); Serial.println(writeAPIKey);
-            #endif
             
-            // Post data to thingspeak
-            if(!this->client->print("POST /update HTTP/1.1\r\n")) return abortWriteRaw();
-            if(!writeHTTPHeader(writeAPIKey)) return abortWriteRaw();
-            if(!this->client->print("Content-Type: application/x-www-form-urlencoded\r\n")) return abortWriteRaw();
-            if(!this->client->print("Content-Length: ")) return abortWriteRaw();
-            if(!this->client->print(contentLen)) return abortWriteRaw();
-            if(!this->client->print("\r\n\r\n")) return abortWriteRaw();
+            /*
+            Function: setFieldIfChanged
+            
+            Summary:
+            Set the value of a field for the next multi-field update, only if it moved past the deadband set by setFieldDeadband().
+            
+            Parameters:
+            field - Field number (1-8) within the channel to set.
+            value - Floating point value (from -999999000000 to 999999000000) to write.
+            
+            Returns:
+            Code of 200 if the value was set.
+            Code of 304 if the value was suppressed by the deadband filter.
+            Code of -101 if value is out of range.
+            Code of -201 if the field number is invalid.
+            
+            Notes:
+            The value is compared with the last value of the field that writeFields() wrote successfully, or that retryLastWrite() wrote after writeFields() failed.
+            If all values were suppressed, writeFields() returns 304 without connecting to ThingSpeak.
+            This feature not available in Arduino Uno due to memory constraints.
+            */
+            int setFieldIfChanged(unsigned int field, float value)
+            {
+                if(field < FIELDNUM_MIN || field > FIELDNUM_MAX) return TS_ERR_INVALID_FIELD_NUM;
                 
-            bool fFirstItem = true;
-            for(size_t iField = 0; iField < FIELDNUM_MAX; iField++){
-                if(this->nextWriteField[iField].length() > 0){
-                    if(!fFirstItem){
-                        if(!this->client->print("&")) return abortWriteRaw();
-                    }
-                    if(!this->client->print("field")) return abortWriteRaw();
-                    if(!this->client->print(iField + 1)) return abortWriteRaw();
-                    if(!this->client->print("=")) return abortWriteRaw();
-                    if(!this->client->print(this->nextWriteField[iField])) return abortWriteRaw();
-                    fFirstItem = false;
+                deadband & filter = this->deadbands[field - 1];
+                if(!deadbandPasses(filter, value))
+                {
+                    #ifdef PRINT_DEBUG_MESSAGES
+                        Serial.print(F("ts::setFieldIfChanged(field: ")); Serial.print(field); Serial.print(F(" value: ")); Serial.print(value,5); Serial.println(F(") suppressed"));
+                    #endif
+                    this->deadbandCounters.suppressed++;
+                    this->deadbandSuppressedSinceWrite = true;
+                    return TS_OK_NOT_MODIFIED;
                 }
+                
+                int status = setField(field, value);
+                if(status != TS_OK_SUCCESS) return status;
+                
+                filter.pending = value;
+                this->deadbandPendingFields |= (1 << (field - 1));
+                this->deadbandCounters.staged++;
+                
+                return TS_OK_SUCCESS;
             }
             
-            if(!isnan(this->nextWriteLatitude)){
-                if(!fFirstItem){
-                    if(!this->client->print("&")) return abortWriteRaw();
-                }
-                if(!this->client->print("lat=")) return abortWriteRaw();
-                if(!this->client->print(this->nextWriteLatitude)) return abortWriteRaw();
-                fFirstItem = false;
-            }
-
-            if(!isnan(this->nextWriteLongitude)){
-                if(!fFirstItem){
-                    if(!this->client->print("&")) return abortWriteRaw();
-                }
-                if(!this->client->print("long=")) return abortWriteRaw();
-                if(!this->client->print(this->nextWriteLongitude)) return abortWriteRaw();
-                fFirstItem = false;
+            
+            /*
+            Function: getDeadbandStats
+            
+            Summary:
+            Get counters of the deadband filter.
+            
+            Returns:
+            Struct with the number of values staged and suppressed by setFieldIfChanged(), and the number of writes skipped because all values were suppressed.
+            */
+            const deadbandStats & getDeadbandStats()
+            {
+                return this->deadbandCounters;
             }
-
-            if(!isnan(this->nextWriteElevation)){
-                if(!fFirstItem){
-                    if(!this->client->print("&")) return abortWriteRaw();
+            
+            
+            /*
+            Function: addSample
+            
+            Summary:
+            Add a sample to the running statistics of a sample series for the current upload window.
+            
+            Parameters:
+            series - Sample series (1-TS_AGGREGATE_SERIES_MAX).
+            value - Sample to add.
+            
+            Returns:
+            Code of 200 if successful.
+            Code of -101 if the series is invalid or value is NaN.
+            
+            Notes:
+            Each series keeps count, last, min, max and mean, and the variance unless TS_AGGREGATE_NO_VARIANCE is defined, in constant memory.
+            Use setFieldAggregate() to map the statistics onto fields, and flushAggregates() to set them at the end of the window.
+            This feature not available in Arduino Uno due to memory constraints.
+            */
+            int addSample(unsigned int series, float value)
+            {
+                if(series < 1 || series > TS_AGGREGATE_SERIES_MAX || isnan(value)) return TS_ERR_OUT_OF_RANGE;
+                
+                aggregate & stats = this->aggregates[series - 1];
+                stats.last = value;
+                if(0 == stats.count++)
+                {
+                    stats.min = value;
+                    stats.max = value;
+                    stats.mean = value;
+                    return TS_OK_SUCCESS;
                 }
-                if(!this->client->print("elevation=")) return abortWriteRaw();
-                if(!this->client->print(this->nextWriteElevation)) return abortWriteRaw();
-                fFirstItem = false;
+                if(value < stats.min) stats.min = value;
+                if(value > stats.max) stats.max = value;
+                
+                float delta = value - stats.mean;
+                stats.mean += delta / stats.count;
+                #ifndef TS_AGGREGATE_NO_VARIANCE
+                    stats.m2 += delta * (value - stats.mean);
+                #endif
+                
+                return TS_OK_SUCCESS;
             }
             
-            if(this->nextWriteStatus.length() > 0){
-                if(!fFirstItem){
-                    if(!this->client->print("&")) return abortWriteRaw();
-                }
-                if(!this->client->print("status=")) return abortWriteRaw();
-                if(!this->client->print(this->nextWriteStatus)) return abortWriteRaw();
-                fFirstItem = false;
+            
+            /*
+            Function: setFieldAggregate
+            
+            Summary:
+            Select the statistic of a sample series that flushAggregates() sets into a field.
+            
+            Parameters:
+            field - Field number (1-8) within the channel.
+            series - Sample series (1-TS_AGGREGATE_SERIES_MAX) added with addSample().
+            statistic - TS_AGGREGATE_LAST, TS_AGGREGATE_MIN, TS_AGGREGATE_MAX, TS_AGGREGATE_MEAN, TS_AGGREGATE_COUNT or TS_AGGREGATE_STDDEV.  TS_AGGREGATE_NONE to clear the mapping.
+            
+            Returns:
+            Code of 200 if successful.
+            Code of -201 if the field number is invalid.
+            Code of -101 if the series or statistic is invalid.
+            
+            Notes:
+            A series can be mapped onto several fields, for example its mean into field 1 and its max into field 2.
+            This feature not available in Arduino Uno due to memory constraints.
+            */
+            int setFieldAggregate(unsigned int field, unsigned int series, unsigned int statistic)
+            {
+                if(field < FIELDNUM_MIN || field > FIELDNUM_MAX) return TS_ERR_INVALID_FIELD_NUM;
+                if(series < 1 || series > TS_AGGREGATE_SERIES_MAX) return TS_ERR_OUT_OF_RANGE;
+                #ifdef TS_AGGREGATE_NO_VARIANCE
+                    if(statistic >= TS_AGGREGATE_STDDEV) return TS_ERR_OUT_OF_RANGE;
+                #else
+                    if(statistic > TS_AGGREGATE_STDDEV) return TS_ERR_OUT_OF_RANGE;
+                #endif
+                
+                this->aggregateSeries[field - 1] = series - 1;
+                this->aggregateStatistic[field - 1] = statistic;
+                
+                return TS_OK_SUCCESS;
             }
             
-            if(this->nextWriteCreatedAt.length() > 0){
-                if(!fFirstItem){
-                    if(!this->client->print("&")) return abortWriteRaw();
+            
+            /*
+            Function: flushAggregates
+            
+            Summary:
+            Set the statistics selected by setFieldAggregate() into their fields, and start a new window.
+            
+            Returns:
+            Code of 200 if at least one field was set.
+            Code of 304 if no mapped series has samples.
+            Code of -101 if a statistic is out of the range of a field.
+            
+            Notes:
+            Call writeFields() afterwards to write the fields.  Fields of series without samples are left unset.
+            All series are reset, including those not mapped onto a field.
+            This feature not available in Arduino Uno due to memory constraints.
+            */
+            int flushAggregates()
+            {
+                int status = TS_OK_NOT_MODIFIED;
+                for(size_t iField = 0; iField < FIELDNUM_MAX; iField++)
+                {
+                    const aggregate & stats = this->aggregates[this->aggregateSeries[iField]];
+                    if(0 == stats.count) continue;
+                    
+                    int fieldStatus;
+                    switch(this->aggregateStatistic[iField])
+                    {
+                        case TS_AGGREGATE_LAST:  fieldStatus = setField(iField + 1, stats.last); break;
+                        case TS_AGGREGATE_MIN:   fieldStatus = setField(iField + 1, stats.min); break;
+                        case TS_AGGREGATE_MAX:   fieldStatus = setField(iField + 1, stats.max); break;
+                        case TS_AGGREGATE_MEAN:  fieldStatus = setField(iField + 1, stats.mean); break;
+                        case TS_AGGREGATE_COUNT: fieldStatus = setField(iField + 1, (long)stats.count); break;
+                        #ifndef TS_AGGREGATE_NO_VARIANCE
+                            case TS_AGGREGATE_STDDEV: fieldStatus = setField(iField + 1, (float)(stats.count > 1 ? sqrt(stats.m2 / (stats.count - 1)) : 0)); break;
+                        #endif
+                        default: continue;
+                    }
+                    // Keep the first error, but still set the remaining fields
+                    if(status > 0) status = fieldStatus;
                 }
-                if(!this->client->print("created_at=")) return abortWriteRaw();
-                if(!this->client->print(this->nextWriteCreatedAt)) return abortWriteRaw();
-                fFirstItem = false;
+                
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("ts::flushAggregates (status: ")); Serial.print(status); Serial.println(F(")"));
+                #endif
+                memset(this->aggregates, 0, sizeof(this->aggregates));
+                
+                return status;
             }
-
-            if(!this->client->print("&headers=false")) return abortWriteRaw();
             
-            resetWriteFields();
             
-            return finishWrite();
-        }
+            /*
+            Function: getAggregate
+            
+            Summary:
+            Get the running statistics of a sample series over the current window.
+            
+            Parameters:
+            series - Sample series (1-TS_AGGREGATE_SERIES_MAX).
+            
+            Returns:
+            Struct with count, last, min, max and mean of the samples added since the last flushAggregates().  Series out of range return the first series.
+            
+            Notes:
+            This feature not available in Arduino Uno due to memory constraints.
+            */
+            const aggregate & getAggregate(unsigned int series)
+            {
+                if(series < 1 || series > TS_AGGREGATE_SERIES_MAX) series = 1;
+                return this->aggregates[series - 1];
+            }
+            
+        #endif
 
          
         /*
-        Function: writeRaw
+        Function: setLatitude
         
         Summary:
-        Write a raw POST to a ThingSpeak channel
+        Set the latitude of a multi-field update.
         
         Parameters:
-        channelNumber - Channel number
-        postMessage - Raw URL to write to ThingSpeak as a string.  See the documentation at https://thingspeak.com/docs/channels#update_feed.
-        writeAPIKey - Write API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        latitude - Latitude of the measurement as a floating point value (degrees N, use negative values for degrees S)
         
         Returns:
-        200 - successful.
-        404 - Incorrect API key (or invalid ThingSpeak server address)
-        -101 - Value is out of range or string is too long (> 255 characters)
-        -201 - Invalid field number specified
-        -210 - setField() was not called before writeFields()
-        -301 - Failed to connect to ThingSpeak
-        -302 - Unexpected failure during write to ThingSpeak
-        -303 - Unable to parse response
-        -304 - Timeout waiting for server to respond
-        -401 - Point was not inserted (most probable cause is the rate limit of once every 15 seconds)
+        Always return 200
         
         Notes:
-        This is low level functionality that will not be required by most users.
+        To record latitude, longitude and elevation of a write, call setField() for each of the fields you want to write. Then setLatitude(), setLongitude(), setElevation() and then call writeFields()
         */
-        int writeRaw(unsigned long channelNumber, String postMessage, const char * writeAPIKey)
+        int setLatitude(float latitude)
         {
             #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("ts::writeRaw   (channelNumber: "); Serial.print(channelNumber); Serial.print(" writeAPIKey: "); Serial.println(writeAPIKey);
-            #endif
-
-            if(!connectThingSpeak())
-            {
-                // Failed to connect to ThingSpeak
-                return TS_ERR_CONNECT_FAILED;
-            }
-
-            postMessage.concat("&headers=false");
-            
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("               POST \"");Serial.print(postMessage);Serial.println("\"");
+                Serial.print(F("ts::setLatitude(latitude: ")); Serial.print(latitude,3); Serial.println(F("\")"));
             #endif
-
-
-            // Post data to thingspeak
-            if(!this->client->print("POST /update HTTP/1.1\r\n")) return abortWriteRaw();
-            if(!writeHTTPHeader(writeAPIKey)) return abortWriteRaw();
-            if(!this->client->print("Content-Type: application/x-www-form-urlencoded\r\n")) return abortWriteRaw();
-            if(!this->client->print("Content-Length: ")) return abortWriteRaw();
-            if(!this->client->print(postMessage.length())) return abortWriteRaw();
-            if(!this->client->print("\r\n\r\n")) return abortWriteRaw();
-            if(!this->client->print(postMessage)) return abortWriteRaw();
-            
-            resetWriteFields();
+            this->nextWriteLatitude = latitude;
             
-            return finishWrite();
+            return TS_OK_SUCCESS;
         }
-        
-         
+
+     
         /*
-        Function: readStringField
+        Function: setLongitude
         
         Summary:
-        Read the latest string from a private ThingSpeak channel
+        Set the longitude of a multi-field update.
         
         Parameters:
-        channelNumber - Channel number
-        field - Field number (1-8) within the channel to read from.
-        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        longitude - Longitude of the measurement as a floating point value (degrees E, use negative values for degrees W)
         
         Returns:
-        Value read (UTF8 string), or empty string if there is an error.  Use getLastReadStatus() to get more specific information.
+        Always return 200
+        
+        Notes:
+        To record latitude, longitude and elevation of a write, call setField() for each of the fields you want to write. Then setLatitude(), setLongitude(), setElevation() and then call writeFields()
         */
-        String readStringField(unsigned long channelNumber, unsigned int field, const char * readAPIKey)
+        int setLongitude(float longitude)
         {
-            if(field < FIELDNUM_MIN || field > FIELDNUM_MAX)
-            {
-                this->lastReadStatus = TS_ERR_INVALID_FIELD_NUM;
-                return("");
-            }
             #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("ts::readStringField(channelNumber: "); Serial.print(channelNumber);
-                if(NULL != readAPIKey)
-                {
-                    Serial.print(" readAPIKey: "); Serial.print(readAPIKey);
-                }
-                Serial.print(" field: "); Serial.print(field); Serial.println(")");
+                Serial.print(F("ts::setLongitude(longitude: ")); Serial.print(longitude,3); Serial.println(F("\")"));
             #endif
-            String suffixURL = String("/fields/");
-            suffixURL.concat(field);
-            suffixURL.concat("/last");
+            this->nextWriteLongitude = longitude;
             
-            return readRaw(channelNumber, suffixURL, readAPIKey);
+            return TS_OK_SUCCESS;
         }
 
-
+         
         /*
-        Function: readStringField
+        Function: setElevation
         
         Summary:
-        Read the latest string from a public ThingSpeak channel
+        Set the elevation of a multi-field update.
         
         Parameters:
-        channelNumber - Channel number
-        field - Field number (1-8) within the channel to read from.
+        elevation - Elevation of the measurement as a floating point value (meters above sea level)
         
         Returns:
-        Value read (UTF8 string), or empty string if there is an error.  Use getLastReadStatus() to get more specific information.
+        Always return 200
+        
+        Notes:
+        To record latitude, longitude and elevation of a write, call setField() for each of the fields you want to write. Then setLatitude(), setLongitude(), setElevation() and then call writeFields()
+        
         */
-        String readStringField(unsigned long channelNumber, unsigned int field)
+        int setElevation(float elevation)
         {
-            return readStringField(channelNumber, field, NULL);
-        }
-
-         
-        /*
-        Function: readFloatField
-        
-        Summary:
-        ead the latest floating point value from a private ThingSpeak channel
-        
-        Parameters:
-        channelNumber - Channel number
-        field - Field number (1-8) within the channel to read from.
-        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
-        
-        Returns:
-        Value read, or 0 if the field is text or there is an error.  Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
-        */
-        float readFloatField(unsigned long channelNumber, unsigned int field, const char * readAPIKey)
-        {
-            return convertStringToFloat(readStringField(channelNumber, field, readAPIKey));
-        }
-
-        
-        /*
-        Function: readFloatField
-        
-        Summary:
-        Read the latest floating point value from a public ThingSpeak channel
-        
-        Parameters:
-        channelNumber - Channel number
-        field - Field number (1-8) within the channel to read from.
-        
-        Returns:
-        Value read, or 0 if the field is text or there is an error.  Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
-        */
-        float readFloatField(unsigned long channelNumber, unsigned int field)
-        {
-            return readFloatField(channelNumber, field, NULL);
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("ts::setElevation(elevation: ")); Serial.print(elevation,3); Serial.println(F("\")"));
+            #endif
+            this->nextWriteElevation = elevation;
+            
+            return TS_OK_SUCCESS;
         }
 
          
         /*
-        Function: readLongField
+        Function: setStatus
         
         Summary:
-        Read the latest long value from a private ThingSpeak channel
+        Set the status field of a multi-field update.
         
         Parameters:
-        channelNumber - Channel number
-        field - Field number (1-8) within the channel to read from.
-        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        status - String to write (UTF8).  ThingSpeak limits this to 255 bytes.
         
         Returns:
-        Value read, or 0 if the field is text or there is an error.  Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
-        */
-        long readLongField(unsigned long channelNumber, unsigned int field, const char * readAPIKey)
-        {
-            // Note that although the function is called "toInt" it really returns a long.
-            return readStringField(channelNumber, field, readAPIKey).toInt();
-        }
-
-         
-        /*
-        Function: readLongField
-        
-        Summary:
-        Read the latest long value from a public ThingSpeak channel
-        
-        Parameters:
-        channelNumber - Channel number
-        field - Field number (1-8) within the channel to read from.
+        Code of 200 if successful.
+        Code of -101 if string is too long (> 255 bytes)
         
-        Returns:
-        Value read, or 0 if the field is text or there is an error.  Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
+        Notes:
+        To record a status message on a write, call setStatus() then call writeFields().
+        Use status to provide additional details when writing a channel update.
         */
-        long readLongField(unsigned long channelNumber, unsigned int field)
+        int setStatus(String status)
         {
-            return readLongField(channelNumber, field, NULL);
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("ts::setStatus(status: ")); Serial.print(status); Serial.println(F("\")"));
+            #endif
+            // Max # bytes for ThingSpeak field is 255 (UTF-8)
+            if(status.length() > FIELDLENGTH_MAX) return TS_ERR_OUT_OF_RANGE;
+            this->nextWriteStatus = status;
+            
+            return TS_OK_SUCCESS;
         }
-
-         
-        /*
-        Function: readIntField
-        
-        Summary:
-        Read the latest int value from a private ThingSpeak channel
-        
-        Parameters:
-        channelNumber - Channel number
-        field - Field number (1-8) within the channel to read from.
-        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
         
-        Returns:
-        Value read, or 0 if the field is text or there is an error.  Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
-        */
-        int readIntField(unsigned long channelNumber, unsigned int field, const char * readAPIKey)
-        {
-            return readLongField(channelNumber, field, readAPIKey);
-        }
 
-         
         /*
-        Function: readIntField
+        Function: setCreatedAt
         
         Summary:
-        Read the latest int value from a public ThingSpeak channel
+        Set the created-at date of a multi-field update.
         
         Parameters:
-        channelNumber - Channel number
-        field - Field number (1-8) within the channel to read from.
+        createdAt - Desired timestamp to be included with the channel update as a String.  The timestamp string must be in the ISO 8601 format. Example "2017-01-12 13:22:54"
         
         Returns:
-        Value read, or 0 if the field is text or there is an error.  Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
-        */
-        int readIntField(unsigned long channelNumber, unsigned int field)
-        {
-            return readLongField(channelNumber, field, NULL);
-        }
-
-
-        /*
-        Function: readStatus
-        
-        Summary:
-        Read the latest status from a private ThingSpeak channel
-        
-        Parameters:
-        channelNumber - Channel number
-        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        Code of 200 if successful.
+        Code of -101 if string is too long (> 255 bytes)
         
-        Results:
-        Value read (UTF8 string). An empty string is returned if there was no status written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+        Notes:
+        Timezones can be set using the timezone hour offset parameter. For example, a timestamp for Eastern Standard Time is: "2017-01-12 13:22:54-05".
+        If no timezone hour offset parameter is used, UTC time is assumed.
         */
-        String readStatus(unsigned long channelNumber, const char * readAPIKey)
+        int setCreatedAt(String createdAt)
         {
-            String content = readRaw(channelNumber, "/feeds/last.txt?status=true", readAPIKey);
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("ts::setCreatedAt(createdAt: ")); Serial.print(createdAt); Serial.println(F("\")"));
+            #endif
             
-            if(getLastReadStatus() != TS_OK_SUCCESS){
-                return String("");
-            }
+            // the ISO 8601 format is too complicated to check for valid timestamps here
+            // we'll need to reply on the api to tell us if there is a problem
+            // Max # bytes for ThingSpeak field is 255 (UTF-8)
+            if(createdAt.length() > FIELDLENGTH_MAX) return TS_ERR_OUT_OF_RANGE;
+            this->nextWriteCreatedAt = createdAt;
             
-            return getJSONValueByKey(content, "status");
+            return TS_OK_SUCCESS;
         }
         
-         
+     
         /*
-        Function: readStatus
+        Function: writeFields
         
         Summary:
-        Read the latest status from a public ThingSpeak channel
+        Write a multi-field update.
         
         Parameters:
         channelNumber - Channel number
+        writeAPIKey - Write API key associated with the channel.  *If you share code with others, do _not_ share this key*
         
-        Results:
-        Value read (UTF8 string). An empty string is returned if there was no status written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
-        */
-        String readStatus(unsigned long channelNumber)
-        {
-            return readStatus(channelNumber, NULL);
-        }
-        
-
-        /*
-        Function: readCreatedAt
-        
-        Summary:
-        Read the created-at timestamp associated with the latest update to a private ThingSpeak channel
-        
-        Parameters:
-        channelNumber - Channel number
-        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        Returns:
+        200 - successful.
+        404 - Incorrect API key (or invalid ThingSpeak server address)
+        -101 - Value is out of range or string is too long (> 255 characters)
+        -201 - Invalid field number specified
+        -210 - setField() was not called before writeFields()
+        -301 - Failed to connect to ThingSpeak
+        -302 - Unexpected failure during write to ThingSpeak
+        -303 - Unable to parse response
+        -304 - Timeout waiting for server to respond
+        -401 - Point was not inserted (most probable cause is the rate limit of once every 15 seconds)
         
-        Results:
-        Value read (UTF8 string). An empty string is returned if there was no created-at timestamp written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+        Notes:
+        Call setField(), setLatitude(), setLongitude(), setElevation() and/or setStatus() and then call writeFields()
         */
-        String readCreatedAt(unsigned long channelNumber, const char * readAPIKey)
+        int writeFields(unsigned long channelNumber, const char * writeAPIKey)
         {
-            String content = readRaw(channelNumber, "/feeds/last.txt", readAPIKey);
+            #ifdef TS_MEMORY_STATS
+                memoryScope scope(this, TS_MEMORY_WRITE_FIELDS, __builtin_frame_address(0));
+            #endif
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("ts::writeFields   (channelNumber: ")); Serial.print(channelNumber); Serial.print(F(" writeAPIKey: ")); Serial.println(writeAPIKey);
+            #endif
             
-            if(getLastReadStatus() != TS_OK_SUCCESS){
-                return String("");
+            #ifndef ARDUINO_AVR_UNO
+                if(0 != getRateLimitDelay(channelNumber))
+                {
+                    // Too soon for this channel; keep the fields, so that later values are coalesced into the next write
+                    TS_STATS_ADD(rateLimited, 1);
+                    return TS_ERR_NOT_INSERTED;
+                }
+            #endif
+            
+            // Serialize the staged values once, so that retries send exactly the same update
+            String postMessage = String();
+            if(!serializeWriteFields(postMessage)){
+                #ifndef ARDUINO_AVR_UNO
+                    if(this->deadbandSuppressedSinceWrite)
+                    {
+                        // Nothing moved past its deadband, skip the request
+                        this->deadbandSuppressedSinceWrite = false;
+                        this->deadbandCounters.writesSkipped++;
+                        return TS_OK_NOT_MODIFIED;
+                    }
+                #endif
+                // setField was not called before writeFields
+                return TS_ERR_SETFIELD_NOT_CALLED;
             }
             
-            return getJSONValueByKey(content, "created_at");
-        }
-
-        
-        /*
-        Function: readCreatedAt
-        
-        Summary:
-        Read the created-at timestamp associated with the latest update to a public ThingSpeak channel
-        
-        Parameters:
-        channelNumber - Channel number
+            #ifndef ARDUINO_AVR_UNO
+                // The staged values become the last sent ones once this update is written, also if only by retryLastWrite()
+                for(size_t iField = 0; iField < FIELDNUM_MAX; iField++)
+                {
+                    this->deadbands[iField].writing = this->deadbands[iField].pending;
+                }
+                this->pendingWriteDeadbandFields = this->deadbandPendingFields;
+                this->deadbandSuppressedSinceWrite = false;
+            #endif
             
-        Results:
-        Value read (UTF8 string). An empty string is returned if there was no created-at timestamp written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
-        */
-        String readCreatedAt(unsigned long channelNumber)
-        {
-            return readCreatedAt(channelNumber, NULL);
-        }
-           
+            resetWriteFields();
             
+            return writeUpdate(channelNumber, postMessage, writeAPIKey);
+        }
+
+         
         /*
-        Function: readRaw
+        Function: writeRaw
         
         Summary:
-        Read a raw response from a private ThingSpeak channel
+        Write a raw POST to a ThingSpeak channel
         
         Parameters:
         channelNumber - Channel number
-        suffixURL - Raw URL to write to ThingSpeak as a String.  See the documentation at https://thingspeak.com/docs/channels#get_feed
-        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        postMessage - Raw URL to write to ThingSpeak as a string.  See the documentation at https://thingspeak.com/docs/channels#update_feed.
+        writeAPIKey - Write API key associated with the channel.  *If you share code with others, do _not_ share this key*
         
         Returns:
-        Response if successful, or empty string. Use getLastReadStatus() to get more specific information.
+        200 - successful.
+        404 - Incorrect API key (or invalid ThingSpeak server address)
+        -101 - Value is out of range or string is too long (> 255 characters)
+        -201 - Invalid field number specified
+        -210 - setField() was not called before writeFields()
+        -301 - Failed to connect to ThingSpeak
+        -302 - Unexpected failure during write to ThingSpeak
+        -303 - Unable to parse response
+        -304 - Timeout waiting for server to respond
+        -401 - Point was not inserted (most probable cause is the rate limit of once every 15 seconds)
         
         Notes:
         This is low level functionality that will not be required by most users.
         */
-        String readRaw(unsigned long channelNumber, String suffixURL, const char * readAPIKey)
+        int writeRaw(unsigned long channelNumber, String postMessage, const char * writeAPIKey)
         {
+            #ifdef TS_MEMORY_STATS
+                memoryScope scope(this, TS_MEMORY_WRITE_RAW, __builtin_frame_address(0));
+            #endif
             #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("ts::readRaw   (channelNumber: "); Serial.print(channelNumber);
-                if(NULL != readAPIKey)
+                Serial.print(F("ts::writeRaw   (channelNumber: ")); Serial.print(channelNumber); Serial.print(F(" writeAPIKey: ")); Serial.println(writeAPIKey);
+            #endif
+
+            #ifndef ARDUINO_AVR_UNO
+                if(0 != getRateLimitDelay(channelNumber))
                 {
-                    Serial.print(" readAPIKey: "); Serial.print(readAPIKey);
+                    TS_STATS_ADD(rateLimited, 1);
+                    return TS_ERR_NOT_INSERTED;
                 }
-                Serial.print(" suffixURL: \""); Serial.print(suffixURL); Serial.println("\")");
             #endif
-
-            if(!connectThingSpeak())
-            {
-                this->lastReadStatus = TS_ERR_CONNECT_FAILED;
-                return String("");
-            }
-
-            String readURL = String("/channels/");
-            readURL.concat(channelNumber);
-            readURL.concat(suffixURL);
-            
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("               GET \"");Serial.print(readURL);Serial.println("\"");
-            #endif
-
-            // Get data from thingspeak
-            if(!this->client->print("GET ")) return abortReadRaw();
-            if(!this->client->print(readURL)) return abortReadRaw();
-            if(!this->client->print(" HTTP/1.1\r\n")) return abortReadRaw();
-            if(!writeHTTPHeader(readAPIKey)) return abortReadRaw();
-            if(!this->client->print("\r\n")) return abortReadRaw();
-            
-            String content = String();
-            int status = getHTTPResponse(content);
-                
-            this->lastReadStatus = status;
             
-            emptyStream();
+            postMessage.concat(F("&headers=false"));
             
-            #ifdef PRINT_DEBUG_MESSAGES
-                if(status == TS_OK_SUCCESS)
-                {
-                    Serial.print("Read: \""); Serial.print(content); Serial.println("\"");
-                }
-            #endif
-                    
-            this->client->stop();
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.println("disconnected.");
+            resetWriteFields();
+            #ifndef ARDUINO_AVR_UNO
+                this->pendingWriteDeadbandFields = 0;
             #endif
-
-            if(status != TS_OK_SUCCESS)
-            {
-                return String("");
-            }
-
-            return content;
-        }
-        
-        
-        /*
-        Function: readRaw
-           
-        Summary:
-        Read a raw response from a public ThingSpeak channel
-           
-        Parameters:
-        channelNumber - Channel number
-        suffixURL - Raw URL to write to ThingSpeak as a String.  See the documentation at https://thingspeak.com/docs/channels#get_feed
-           
-        Returns:
-        Response if successful, or empty string. Use getLastReadStatus() to get more specific information.
-           
-        Notes:
-        This is low level functionality that will not be required by most users.
-        */
-        String readRaw(unsigned long channelNumber, String suffixURL)
-        {
-            return readRaw(channelNumber, suffixURL, NULL);
+            
+            return writeUpdate(channelNumber, postMessage, writeAPIKey);
         }
         
         
-        #ifndef ARDUINO_AVR_UNO // Arduino Uno doesn't have enough memory to perform the following functionalities.
-            
+        #ifndef ARDUINO_AVR_UNO
             /*
-            Function: readMultipleFields
-             
+            Function: setWriteTemplate
+            
             Summary:
-            Read all the field values, status message, location coordinates, and created-at timestamp associated with the latest feed to a private ThingSpeak channel and store the values locally in variables within a struct.
-             
+            Render a complete update request once into a buffer, so that writeTemplate() only has to patch the values and send it.
+            
             Parameters:
+            buffer - Buffer that holds the request.  It must remain valid while the template is in use.
+            size - Size of the buffer in bytes.  The headers take about 200 bytes, each field 8 more than width.
             channelNumber - Channel number
-            readAPIKey - Read API key associated with the channel. *If you share code with others, do _not_ share this key*
-             
+            writeAPIKey - Write API key associated with the channel.  *If you share code with others, do _not_ share this key*
+            fields - Fields in the request, one bit per field starting with field 1 in bit 0, e.g. 0x07 for fields 1 to 3.
+            width - Characters of each value, including the sign and decimal point (at most TS_TEMPLATE_WIDTH_MAX).
+            decimals - Digits after the decimal point.
+            
             Returns:
-            HTTP status code of 200 if successful.
+            Code of 200 if successful.
+            Code of -101 if the buffer is too small, no field is selected, or the width can't hold the decimals.
             
             Notes:
-            See getLastReadStatus() for other possible return values.
+            Values are sent zero-padded to the full width, e.g. 0023.50 for a width of 7 with 2 decimals, and are all 0 until set with setTemplateField().
+            The template captures the server, API key and fields as they are now; call setWriteTemplate() again after setServer().
+            This feature not available in Arduino Uno due to memory constraints.
             */
-            int readMultipleFields(unsigned long channelNumber, const char * readAPIKey)
+            int setWriteTemplate(char * buffer, size_t size, unsigned long channelNumber, const char * writeAPIKey, uint8_t fields, uint8_t width, uint8_t decimals)
             {
-                String readCondition = "/feeds/last.txt?status=true&location=true";
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("ts::setWriteTemplate (channelNumber: ")); Serial.print(channelNumber); Serial.print(F(" fields: ")); Serial.print(fields); Serial.print(F(" width: ")); Serial.print(width); Serial.print(F(" decimals: ")); Serial.print(decimals); Serial.println(F(")"));
+                #endif
                 
-                String multiContent = readRaw(channelNumber, readCondition, readAPIKey);
+                this->writeTemplateState.length = 0;
+                if(NULL == buffer || 0 == fields || 0 == width || width > TS_TEMPLATE_WIDTH_MAX || (0 != decimals && width < decimals + 2))
+                {
+                    return TS_ERR_OUT_OF_RANGE;
+                }
                 
-                if(getLastReadStatus() != TS_OK_SUCCESS){
-                    return getLastReadStatus();
+                size_t bodyLength = 14;     // &headers=false
+                for(unsigned int field = FIELDNUM_MIN; field <= FIELDNUM_MAX; field++)
+                {
+                    if(fields & (1 << (field - 1))) bodyLength += 8 + width;  // &fieldN= and the value
+                }
+                bodyLength--;   // No & before the first field
+                
+                ThingSpeakBufferPrint out(buffer, size);
+                printFlash(out, F("POST /update HTTP/1.1\r\n"));
+                writeHTTPHeader(out, writeAPIKey);
+                printFlash(out, F("Content-Type: application/x-www-form-urlencoded\r\n"));
+                printFlash(out, F("Content-Length: "));
+                out.print(bodyLength);
+                printFlash(out, F("\r\n\r\n"));
+                
+                for(unsigned int field = FIELDNUM_MIN; field <= FIELDNUM_MAX; field++)
+                {
+                    this->writeTemplateState.slot[field - 1] = 0;
+                    if(0 == (fields & (1 << (field - 1)))) continue;
+                    
+                    if(out.length > 0 && '\n' != buffer[out.length - 1]) out.print('&');
+                    printFlash(out, F("field"));
+                    out.print(field);
+                    out.print('=');
+                    this->writeTemplateState.slot[field - 1] = out.length;
+                    for(unsigned int position = 0; position < width; position++)
+                    {
+                        out.print((0 != decimals && position == width - decimals - 1u) ? '.' : '0');
+                    }
+                }
+                printFlash(out, F("&headers=false"));
+                
+                if(out.overflow)
+                {
+                    return TS_ERR_OUT_OF_RANGE;
                 }
                 
-                this->lastFeed.nextReadField[0] = parseValues(multiContent, "field1");
-                this->lastFeed.nextReadField[1] = parseValues(multiContent, "field2");
-                this->lastFeed.nextReadField[2] = parseValues(multiContent, "field3");
-                this->lastFeed.nextReadField[3] = parseValues(multiContent, "field4");
-                this->lastFeed.nextReadField[4] = parseValues(multiContent, "field5");
-                this->lastFeed.nextReadField[5] = parseValues(multiContent, "field6");
-                this->lastFeed.nextReadField[6] = parseValues(multiContent, "field7");
-                this->lastFeed.nextReadField[7] = parseValues(multiContent, "field8");
-                this->lastFeed.nextReadCreatedAt = parseValues(multiContent, "created_at");
-                this->lastFeed.nextReadLatitude = parseValues(multiContent, "latitude");
-                this->lastFeed.nextReadLongitude = parseValues(multiContent, "longitude");
-                this->lastFeed.nextReadElevation = parseValues(multiContent, "elevation");
-                this->lastFeed.nextReadStatus = parseValues(multiContent, "status");
+                this->writeTemplateState.buffer = buffer;
+                this->writeTemplateState.length = out.length;
+                this->writeTemplateState.channelNumber = channelNumber;
+                this->writeTemplateState.width = width;
+                this->writeTemplateState.decimals = decimals;
+                this->writeTemplateState.scale = 1;
+                for(uint8_t iDecimal = 0; iDecimal < decimals; iDecimal++)
+                {
+                    this->writeTemplateState.scale *= 10;
+                }
                 
                 return TS_OK_SUCCESS;
             }
             
             
             /*
-            Function: readMultipleFields
+            Function: setTemplateField
             
             Summary:
-            Read all the field values, status message, location coordinates, and created-at timestamp associated with the latest update to a private ThingSpeak channel and store the values locally in variables within a struct.
-             
+            Patch the value of a field in the request rendered by setWriteTemplate().
+            
             Parameters:
-            channelNumber - Channel number
-            readAPIKey - Read API key associated with the channel. *If you share code with others, do _not_ share this key*
-             
+            field - Field number (1-8) within the channel to set.
+            value - Value to write.  It's rounded to the decimals of the template.
+            
             Returns:
-            HTTP status code of 200 if successful.
+            Code of 200 if successful.
+            Code of -101 if the value is not finite or doesn't fit the width of the template.
+            Code of -201 if the field is not part of the template.
             
             Notes:
-            See getLastReadStatus() for other possible return values.
+            The value stays in the request until it's set again, so values that didn't change don't need to be set for every write.
+            This feature not available in Arduino Uno due to memory constraints.
             */
-            int readMultipleFields(unsigned long channelNumber)
+            int setTemplateField(unsigned int field, float value)
             {
-                return readMultipleFields(channelNumber, NULL);
+                if(field < FIELDNUM_MIN || field > FIELDNUM_MAX || 0 == this->writeTemplateState.length || 0 == this->writeTemplateState.slot[field - 1])
+                {
+                    return TS_ERR_INVALID_FIELD_NUM;
+                }
+                if(isnan(value) || isinf(value))
+                {
+                    return TS_ERR_OUT_OF_RANGE;
+                }
+                
+                bool negative = value < 0;
+                float scaled = (negative ? -value : value) * this->writeTemplateState.scale + 0.5f;
+                if(scaled >= 4000000000.0f)
+                {
+                    return TS_ERR_OUT_OF_RANGE;
+                }
+                
+                // Fill the digits in from the right, so the value is zero-padded to the width
+                unsigned long digits = (unsigned long)scaled;
+                if(0 == digits)
+                {
+                    // A negative value that rounds to 0 is written as 0, not -0
+                    negative = false;
+                }
+                uint8_t width = this->writeTemplateState.width;
+                uint8_t point = (0 != this->writeTemplateState.decimals) ? width - this->writeTemplateState.decimals - 1 : width;
+                char text[TS_TEMPLATE_WIDTH_MAX];
+                for(int position = width - 1; position >= 0; position--)
+                {
+                    if(position == point)
+                    {
+                        text[position] = '.';
+                        continue;
+                    }
+                    text[position] = '0' + (digits % 10);
+                    digits /= 10;
+                }
+                if(0 != digits || (negative && '0' != text[0]))
+                {
+                    return TS_ERR_OUT_OF_RANGE;
+                }
+                if(negative) text[0] = '-';
+                
+                memcpy(this->writeTemplateState.buffer + this->writeTemplateState.slot[field - 1], text, width);
+                return TS_OK_SUCCESS;
             }
             
             
             /*
-            Function: getFieldAsString
-             
-            Summary:
-            Fetch the value as string from the latest stored feed record.
+            Function: writeTemplate
             
-            Parameters:
-            field - Field number (1-8) within the channel to read from.
+            Summary:
+            Send the request rendered by setWriteTemplate() with the values set by setTemplateField(), in a single write to the client.
             
             Returns:
-            Value read (UTF8 string), empty string if there is an error, or old value read (UTF8 string) if invoked before readMultipleFields().  Use getLastReadStatus() to get more specific information.
+            HTTP status code of 200 if successful.
+            Code of -210 if setWriteTemplate() was not called.
+            See writeFields() for other possible return values.
+            
+            Notes:
+            Failed writes are not kept for retryLastWrite(); the template can simply be sent again.
+            This feature not available in Arduino Uno due to memory constraints.
             */
-            String getFieldAsString(unsigned int field)
+            int writeTemplate()
             {
-                if(field < FIELDNUM_MIN || field > FIELDNUM_MAX)
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("ts::writeTemplate (channelNumber: ")); Serial.print(this->writeTemplateState.channelNumber); Serial.println(F(")"));
+                #endif
+                
+                if(0 == this->writeTemplateState.length)
                 {
-                    this->lastReadStatus = TS_ERR_INVALID_FIELD_NUM;
-                    return("");
+                    return TS_ERR_SETFIELD_NOT_CALLED;
                 }
                 
-                this->lastReadStatus = TS_OK_SUCCESS;
-                return this->lastFeed.nextReadField[field-1];
+                if(0 != getRateLimitDelay(this->writeTemplateState.channelNumber))
+                {
+                    TS_STATS_ADD(rateLimited, 1);
+                    return TS_ERR_NOT_INSERTED;
+                }
+                
+                int status = sendTemplate();
+                if(staleConnectionFailed(status)) status = sendTemplate();
+                
+                if(status == TS_OK_SUCCESS)
+                {
+                    recordChannelWrite(this->writeTemplateState.channelNumber);
+                }
+                
+                return status;
             }
-            
-            
+        #endif
+        
+        
+        #ifndef ARDUINO_AVR_UNO
             /*
-            Function: getFieldAsFloat
-             
+            Function: setRetryPolicy
+            
             Summary:
-            Fetch the value as float from the latest stored feed record.
+            Retry writes that failed for a transient reason.
             
             Parameters:
-            field - Field number (1-8) within the channel to read from.
+            maxAttempts - Maximum number of attempts per write, including the first one.  1 (the default) disables retries.
+            backoffMs - Delay in milliseconds before the first retry.  It doubles for every further retry.
+            budgetMs - Total time in milliseconds a write may spend including retries.  No retry is started that would exceed it.
             
             Returns:
-            Value read, 0 if the field is text or there is an error, or old value read if invoked before readMultipleFields(). Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
+            Code of 200 if successful.
+            Code of -101 if maxAttempts is 0.
+            
+            Notes:
+            Writes are retried on -301, -302, -303, -304 and on HTTP 5xx responses.  They are not retried on -305 (circuit open), -401 (rate limit) or 4xx responses.
+            The serialized update is kept, so retries do not format the values again.  If a time source is set with setTimeSource(), the update carries a created_at timestamp taken when it was first serialized, so that a retry after an ambiguous timeout writes the same timestamp.
             */
-            float getFieldAsFloat(unsigned int field)
+            int setRetryPolicy(unsigned int maxAttempts, unsigned long backoffMs, unsigned long budgetMs)
             {
-                return convertStringToFloat(getFieldAsString(field));
+                if(0 == maxAttempts) return TS_ERR_OUT_OF_RANGE;
+                
+                this->retryMaxAttempts = maxAttempts;
+                this->retryBackoff = backoffMs;
+                this->retryBudget = budgetMs;
+                
+                return TS_OK_SUCCESS;
             }
             
             
             /*
-            Function: getFieldAsLong
+            Function: retryLastWrite
             
             Summary:
-            Fetch the value as long from the latest stored feed record.
-            
-            Parameters:
-            field - Field number (1-8) within the channel to read from.
+            Send the last update written by writeField(), writeFields() or writeRaw() again, if it did not succeed.
             
             Returns:
-            Value read, 0 if the field is text or there is an error, or old value read if invoked before readMultipleFields(). Use getLastReadStatus() to get more specific information.
+            HTTP status code of 200 if successful.
+            Code of -210 if there is no failed update to send.
+            Code of -401 if the rate limit set with setRateLimit() doesn't allow a write to the channel yet; the update is kept.
+            See writeFields() for other possible return values.
+            
+            Notes:
+            The update is kept exactly as it was serialized, including its created_at timestamp.  It is discarded once it was written successfully, or when the next update is written.
             */
-            long getFieldAsLong(unsigned int field)
+            int retryLastWrite()
             {
-                // Note that although the function is called "toInt" it really returns a long.
-                return getFieldAsString(field).toInt();
+                if(0 == this->pendingWrite.length())
+                {
+                    return TS_ERR_SETFIELD_NOT_CALLED;
+                }
+                
+                if(0 != getRateLimitDelay(this->pendingWriteChannel))
+                {
+                    TS_STATS_ADD(rateLimited, 1);
+                    return TS_ERR_NOT_INSERTED;
+                }
+                
+                return sendPendingWrite();
             }
+        #endif
+        
+        
+        /*
+        Function: setTimeSource
+        
+        Summary:
+        Set the clock used to timestamp updates.
+        
+        Parameters:
+        epochNow - Function that returns the current time as seconds since 1970-01-01 UTC, or 0 if the time is not known.  NULL removes the time source.
+        
+        Returns:
+        Always returns 200
+        
+        Notes:
+        While a time source is set, writeFields() adds created_at to every update that does not have one from setCreatedAt().
+        To timestamp updates with the clock kept by now(), pass a function that returns ThingSpeak.now().
+        */
+        int setTimeSource(unsigned long (*epochNow)())
+        {
+            this->timeSource = epochNow;
+            
+            return TS_OK_SUCCESS;
+        }
+        
+        
+        /*
+        Function: now
+        
+        Summary:
+        Get the current time, kept in step with the Date header of ThingSpeak's responses.
+        
+        Returns:
+        Seconds since 1970-01-01 UTC, or 0 if no response was received yet.
+        
+        Notes:
+        The clock is set by the first response and then slewed within the one second resolution of the Date header.  Its corrections over at least TS_CLOCK_DRIFT_WINDOW_MS are used to correct the drift of millis().
+        queueFields() timestamps samples with this clock if no time source is set with setTimeSource().
+        */
+        unsigned long now()
+        {
+            if(!this->clockSynced) return 0;
             
+            return this->clockEpoch + clockElapsedMs() / 1000;
+        }
+        
+        
+        /*
+        Function: formatISO8601
+        
+        Summary:
+        Format a time as ISO 8601 text, for example for setCreatedAt().
+        
+        Parameters:
+        epoch - Seconds since 1970-01-01 UTC, for example from now().
+        text - Buffer of at least TS_ISO8601_LENGTH (21) characters that receives the time as YYYY-MM-DDTHH:MM:SSZ.
+        */
+        void formatISO8601(unsigned long epoch, char * text)
+        {
+            // Convert days since 1970-01-01 to a civil date (proleptic Gregorian calendar), see http://howardhinnant.github.io/date_algorithms.html
+            unsigned long days = epoch / 86400UL;
+            unsigned long secondOfDay = epoch % 86400UL;
+            unsigned long z = days + 719468UL;
+            unsigned long era = z / 146097UL;
+            unsigned long dayOfEra = z - era * 146097UL;
+            unsigned long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+            unsigned long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+            unsigned int monthIndex = (5 * dayOfYear + 2) / 153;
+            unsigned int day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+            unsigned int month = (monthIndex < 10) ? monthIndex + 3 : monthIndex - 9;
+            unsigned int year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
             
+            // YYYY-MM-DDTHH:MM:SSZ
+            unsigned int parts[6] = {year, month, day, (unsigned int)(secondOfDay / 3600), (unsigned int)(secondOfDay / 60 % 60), (unsigned int)(secondOfDay % 60)};
+            const char separators[6] = {'-', '-', 'T', ':', ':', 'Z'};
+            for(size_t i = 0; i < 6; i++)
+            {
+                if(0 == i)
+                {
+                    *text++ = '0' + parts[0] / 1000;
+                    *text++ = '0' + parts[0] / 100 % 10;
+                }
+                *text++ = '0' + parts[i] / 10 % 10;
+                *text++ = '0' + parts[i] % 10;
+                *text++ = separators[i];
+            }
+            *text = '\0';
+        }
+        
+        
+        #ifndef ARDUINO_AVR_UNO // Arduino Uno doesn't have enough memory to perform the following functionalities.
+        
             /*
-            Function: getFieldAsInt
-             
+            Function: setSampleQueue
+            
             Summary:
-            Fetch the value as int from the latest stored feed record.
+            Set the memory that queueFields() stores samples of a priority in.
             
             Parameters:
-            field - Field number (1-8) within the channel to read from.
+            buffer - Memory for the queue, for example a static array or RTC memory that survives a deep sleep.  NULL to stop queueing.
+            size - Size of buffer in bytes (at most 65535 bytes are used).
+            priority - TS_PRIORITY_ROUTINE (the default) or TS_PRIORITY_ALARM.
             
             Returns:
-            Value read, 0 if the field is text or there is an error, or old value read if invoked before readMultipleFields(). Use getLastReadStatus() to get more specific information.
+            Code of 200 if successful.
+            Code of -101 if buffer is too small to hold a sample, or the priority is invalid.
+            
+            Notes:
+            If buffer already holds a queue of the same size, its samples and field scales are kept.  Otherwise the queue starts empty.
+            A sample takes 2 bytes per field, plus 2 to 6 bytes for its presence bitmap and time delta.
+            This feature not available in Arduino Uno due to memory constraints.
             */
-            int getFieldAsInt(unsigned int field)
+            int setSampleQueue(uint8_t * buffer, size_t size, unsigned int priority = TS_PRIORITY_ROUTINE)
             {
-                // int and long are same
-                return getFieldAsLong(field);
+                if(priority >= TS_PRIORITY_LEVELS) return TS_ERR_OUT_OF_RANGE;
+                
+                priorityQueue & queue = this->queues[priority];
+                queue.buffer = NULL;
+                if(NULL == buffer) return TS_OK_SUCCESS;
+                if(size < sizeof(sampleQueue) + TS_SAMPLE_RECORD_MAX) return TS_ERR_OUT_OF_RANGE;
+                
+                size_t capacity = size - sizeof(sampleQueue);
+                if(capacity > 0xFFFF) capacity = 0xFFFF;
+                
+                queue.buffer = buffer;
+                memcpy(&queue.header, buffer, sizeof(sampleQueue));
+                if(queue.header.magic != TS_SAMPLE_QUEUE_MAGIC || queue.header.capacity != capacity || queue.header.used > capacity)
+                {
+                    memset(&queue.header, 0, sizeof(sampleQueue));
+                    queue.header.magic = TS_SAMPLE_QUEUE_MAGIC;
+                    queue.header.capacity = capacity;
+                    storeSampleQueue(queue);
+                }
+                
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("ts::setSampleQueue (priority: ")); Serial.print(priority); Serial.print(F(" capacity: ")); Serial.print(queue.header.capacity); Serial.print(F(" queued: ")); Serial.print(queue.header.count); Serial.println(F(")"));
+                #endif
+                
+                return TS_OK_SUCCESS;
             }
             
-                
+            
             /*
-            Function: getStatus
-             
+            Function: setQueueFieldScale
+            
             Summary:
-            Fetch the status message associated with the latest stored feed record.
+            Set how queueFields() stores the values of a field.
             
-            Results:
-            Value read (UTF8 string). An empty string is returned if there was no status written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+            Parameters:
+            field - Field number (1-8) within the channel.
+            scale - Resolution of the field, for example 0.01 to keep two decimals.  Values are stored as 16 bit multiples of scale, so the range is +/-32767 * scale.  0 stores values as float16 (about 3 significant digits, up to +/-65504), which is the default.
+            
+            Returns:
+            Code of 200 if successful.
+            Code of -201 if the field number is invalid.
+            Code of -101 if scale is negative, no queue is set, or samples with a different scale are queued.
+            
+            Notes:
+            The scale applies to the queues of all priorities set with setSampleQueue(), and is kept in their buffers together with the samples.
+            This feature not available in Arduino Uno due to memory constraints.
             */
-            String getStatus()
+            int setQueueFieldScale(unsigned int field, float scale)
             {
-                return this->lastFeed.nextReadStatus;
+                if(field < FIELDNUM_MIN || field > FIELDNUM_MAX) return TS_ERR_INVALID_FIELD_NUM;
+                if(!(scale >= 0)) return TS_ERR_OUT_OF_RANGE;
+                
+                bool queueSet = false;
+                for(size_t priority = 0; priority < TS_PRIORITY_LEVELS; priority++)
+                {
+                    priorityQueue & queue = this->queues[priority];
+                    if(NULL == queue.buffer) continue;
+                    queueSet = true;
+                    // Queued samples would decode with the wrong scale
+                    if(queue.header.scale[field - 1] != scale && queue.header.count > 0) return TS_ERR_OUT_OF_RANGE;
+                }
+                if(!queueSet) return TS_ERR_OUT_OF_RANGE;
+                
+                for(size_t priority = 0; priority < TS_PRIORITY_LEVELS; priority++)
+                {
+                    priorityQueue & queue = this->queues[priority];
+                    if(NULL == queue.buffer || queue.header.scale[field - 1] == scale) continue;
+                    queue.header.scale[field - 1] = scale;
+                    storeSampleQueue(queue);
+                }
+                
+                return TS_OK_SUCCESS;
             }
             
             
             /*
-            Function: getLatitude
-             
+            Function: setQueueChannel
+            
             Summary:
-            Fetch the latitude associated with the latest stored feed record.
+            Write the samples of a priority to their own channel, for example alarms to a channel that triggers a reaction.
             
-            Results:
-            Value read (UTF8 string). An empty string is returned if there was no latitude written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+            Parameters:
+            priority - TS_PRIORITY_ROUTINE or TS_PRIORITY_ALARM.
+            channelNumber - Channel number.  0 to write to the channel passed to writeQueuedFields().
+            writeAPIKey - Write API key associated with the channel.
+            
+            Returns:
+            Code of 200 if successful.
+            Code of -101 if the priority is invalid, or a channel number is given without a write API key.
+            
+            Notes:
+            This feature not available in Arduino Uno due to memory constraints.
             */
-            String getLatitude()
+            int setQueueChannel(unsigned int priority, unsigned long channelNumber, const char * writeAPIKey)
             {
-                return this->lastFeed.nextReadLatitude;
+                if(priority >= TS_PRIORITY_LEVELS) return TS_ERR_OUT_OF_RANGE;
+                // The key is only read when the batch is written, so check it now rather than fail the alarm then
+                if(0 != channelNumber && (NULL == writeAPIKey || '\0' == *writeAPIKey)) return TS_ERR_OUT_OF_RANGE;
+                
+                this->queues[priority].channelNumber = channelNumber;
+                this->queues[priority].writeAPIKey = writeAPIKey;
+                
+                return TS_OK_SUCCESS;
             }
             
             
             /*
-            Function: getLongitude
-             
+            Function: setQueueBatch
+            
             Summary:
-            Fetch the longitude associated with the latest stored feed record.
+            Hold back the samples of a priority until a batch of them is queued.
             
-            Results:
-            Value read (UTF8 string). An empty string is returned if there was no longitude written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+            Parameters:
+            priority - TS_PRIORITY_ROUTINE or TS_PRIORITY_ALARM.
+            minSamples - Samples to collect before writeQueuedFields() sends them.  0 or 1 to send every sample as soon as possible (the default).
+            maxAgeSeconds - Send a smaller batch once its oldest sample waited this long.  0 for no limit.
+            
+            Returns:
+            Code of 200 if successful.
+            Code of -101 if the priority is invalid.
+            
+            Notes:
+            Batching routine samples keeps the number of bulk updates low, while alarms are sent by the next call to writeQueuedFields().
+            This feature not available in Arduino Uno due to memory constraints.
             */
-            String getLongitude()
+            int setQueueBatch(unsigned int priority, unsigned int minSamples, unsigned long maxAgeSeconds)
             {
-                return this->lastFeed.nextReadLongitude;
+                if(priority >= TS_PRIORITY_LEVELS) return TS_ERR_OUT_OF_RANGE;
+                
+                this->queues[priority].batchMin = minSamples;
+                this->queues[priority].batchMaxAge = maxAgeSeconds;
+                
+                return TS_OK_SUCCESS;
             }
             
             
             /*
-            Function: getElevation
-             
+            Function: queueFields
+            
             Summary:
-            Fetch the longitude associated with the latest stored feed record.
+            Move the fields set with setField() into the sample queue, instead of writing them.
             
-            Results:
-            Value read (UTF8 string). An empty string is returned if there was no elevation written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+            Parameters:
+            timestamp - Time of the sample in seconds since 1970-01-01 UTC.  0 to take the time from the time source set with setTimeSource(), or else from now().
+            priority - TS_PRIORITY_ROUTINE (the default) or TS_PRIORITY_ALARM.
+            
+            Returns:
+            Code of 200 if successful.
+            Code of -101 if no sample queue is set for the priority, the time is not known (no time source and no response from ThingSpeak yet), the time is earlier than that of the last sample in the queue, a value is not numeric or out of the range of its field scale, or latitude, longitude, elevation, status or created at was set.
+            Code of -210 if setField() was not called before queueFields().
+            
+            Notes:
+            Only numeric field values are queued; NaN values are left out.  When the queue is full, the oldest samples are overwritten.
+            The samples are stored in a compact binary form, and only formatted as text by writeQueuedFields().
+            This feature not available in Arduino Uno due to memory constraints.
             */
-            String getElevation()
+            int queueFields(unsigned long timestamp = 0, unsigned int priority = TS_PRIORITY_ROUTINE)
             {
-                return this->lastFeed.nextReadElevation;
+                if(priority >= TS_PRIORITY_LEVELS || NULL == this->queues[priority].buffer) return TS_ERR_OUT_OF_RANGE;
+                priorityQueue & queue = this->queues[priority];
+                
+                if(0 == timestamp) timestamp = currentTime();
+                if(0 == timestamp) return TS_ERR_OUT_OF_RANGE;
+                // Timestamps are stored as deltas to the previous sample, so they can't go back
+                if(queue.header.count > 0 && timestamp < queue.header.tailTime) return TS_ERR_OUT_OF_RANGE;
+                if(!isnan(this->nextWriteLatitude) || !isnan(this->nextWriteLongitude) || !isnan(this->nextWriteElevation) || this->nextWriteStatus.length() > 0 || this->nextWriteCreatedAt.length() > 0)
+                {
+                    return TS_ERR_OUT_OF_RANGE;
+                }
+                
+                uint8_t presence = 0;
+                uint8_t values[2 * FIELDNUM_MAX];
+                size_t valuesLength = 0;
+                bool fieldSet = false;
+                for(size_t iField = 0; iField < FIELDNUM_MAX; iField++)
+                {
+                    if(0 == this->nextWriteField[iField].length()) continue;
+                    fieldSet = true;
+                    
+                    const char * valueString = this->nextWriteField[iField].c_str();
+                    if(!isNumber(valueString)) return TS_ERR_OUT_OF_RANGE;
+                    float value = convertCharToFloat(valueString);
+                    if(isnan(value)) continue;
+                    
+                    uint16_t encoded;
+                    if(!encodeSampleValue(value, queue.header.scale[iField], encoded)) return TS_ERR_OUT_OF_RANGE;
+                    presence |= (1 << iField);
+                    values[valuesLength++] = encoded & 0xFF;
+                    values[valuesLength++] = encoded >> 8;
+                }
+                if(!fieldSet) return TS_ERR_SETFIELD_NOT_CALLED;
+                
+                // Presence bitmap, then the seconds since the previous sample as a varint, then the values
+                uint8_t record[TS_SAMPLE_RECORD_MAX];
+                size_t length = 0;
+                record[length++] = presence;
+                unsigned long delta = (queue.header.count > 0) ? timestamp - queue.header.tailTime : 0;
+                do
+                {
+                    record[length++] = (delta & 0x7F) | (delta > 0x7F ? 0x80 : 0);
+                    delta >>= 7;
+                }while(delta > 0);
+                memcpy(&record[length], values, valuesLength);
+                length += valuesLength;
+                
+                while(queue.header.used + length > queue.header.capacity)
+                {
+                    dropOldestSample(queue);
+                    if(queue.header.dropped < UINT16_MAX) queue.header.dropped++;
+                }
+                
+                for(size_t i = 0; i < length; i++)
+                {
+                    queue.buffer[sizeof(sampleQueue) + (queue.header.head + queue.header.used + i) % queue.header.capacity] = record[i];
+                }
+                if(0 == queue.header.count)
+                {
+                    queue.header.headTime = timestamp;
+                }
+                queue.header.tailTime = timestamp;
+                queue.header.used += length;
+                queue.header.count++;
+                storeSampleQueue(queue);
+                
+                resetWriteFields();
+                
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("ts::queueFields (timestamp: ")); Serial.print(timestamp); Serial.print(F(" priority: ")); Serial.print(priority); Serial.print(F(" bytes: ")); Serial.print(length); Serial.print(F(" queued: ")); Serial.print(queue.header.count); Serial.println(F(")"));
+                #endif
+                
+                return TS_OK_SUCCESS;
             }
             
             
             /*
-            Function: getCreatedAt
-             
+            Function: writeQueuedFields
+            
             Summary:
-            Fetch the created-at timestamp associated with the latest stored feed record.
+            Write queued samples to ThingSpeak in one bulk update, highest priority first.
             
-            Results:
-            Value read (UTF8 string). An empty string is returned if there was no created-at timestamp written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
-            */
-            String getCreatedAt()
-            {
-                return this->lastFeed.nextReadCreatedAt;
-            }
-        
-        #endif
-        
-     
-        /*
-        Function: getLastReadStatus
-        
-        Summary:
-        Get the status of the previous read.
-        
-        Returns:
-        Generally, these are HTTP status codes.  Negative values indicate an error generated by the library.
-        Possible response codes...
-        200 - OK / Success
-        404 - Incorrect API key (or invalid ThingSpeak server address)
-        -101 - Value is out of range or string is too long (> 255 characters)
-        -201 - Invalid field number specified
-        -210 - setField() was not called before writeFields()
-        -301 - Failed to connect to ThingSpeak
-        -302 -  Unexpected failure during write to ThingSpeak
-        -303 - Unable to parse response
-        -304 - Timeout waiting for server to respond
-        -401 - Point was not inserted (most probable cause is exceeding the rate limit)
-        
-        Notes:
-        The read functions will return zero or empty if there is an error.  Use this function to retrieve the details.
-        */
-        int getLastReadStatus()
-        {
-            return this->lastReadStatus;
-        }
-        
-        
-    private:
+            Parameters:
+            channelNumber - Channel number, used for priorities without a channel of their own (see setQueueChannel()).
+            writeAPIKey - Write API key associated with the channel.
             
-        int getWriteFieldsContentLength(){
-            size_t iField;
-            int contentLen = 0;
+            Returns:
+            Code of 200 if the samples were accepted.
+            Code of 304 if samples are queued, but no batch is due yet (see setQueueBatch()).
+            Code of -210 if no samples are queued.
+            Code of -101 if no sample queue is set.
+            Code of -301 if failed to connect to ThingSpeak
+            Code of -302 if unexpected failure during write to ThingSpeak
+            Code of -304 if timeout waiting for server to respond
             
-            for(iField = 0; iField < FIELDNUM_MAX; iField++){
-                if(this->nextWriteField[iField].length() > 0){
-                    contentLen = contentLen + 8 + this->nextWriteField[iField].length();	// &fieldX=[value]
+            Notes:
+            Each call sends one bulk update of up to TS_BULK_UPDATE_MAX samples of the highest priority that has a batch due; call again later for the rest.
+            So an alarm is sent by the next call, even while a backlog of routine samples is replayed.  Samples stay queued until ThingSpeak accepted them.
+            This feature not available in Arduino Uno due to memory constraints.
+            */
+            int writeQueuedFields(unsigned long channelNumber, const char * writeAPIKey)
+            {
+                bool queueSet = false;
+                bool samplesQueued = false;
+                for(int priority = TS_PRIORITY_LEVELS - 1; priority >= 0; priority--)
+                {
+                    priorityQueue & queue = this->queues[priority];
+                    if(NULL == queue.buffer) continue;
+                    queueSet = true;
+                    if(0 == queue.header.count) continue;
+                    samplesQueued = true;
+                    if(!sampleBatchDue(queue)) continue;
                     
-                    // future-proof in case ThingSpeak allows 999 fields someday
-                    if(iField > 9){
-                        contentLen = contentLen + 1;
-                    }
-                    else if(iField > 99){
-                        contentLen = contentLen + 2;
+                    if(0 != queue.channelNumber)
+                    {
+                        return writeSampleQueue(queue, queue.channelNumber, queue.writeAPIKey);
                     }
-                    
+                    return writeSampleQueue(queue, channelNumber, writeAPIKey);
                 }
+                
+                if(!queueSet) return TS_ERR_OUT_OF_RANGE;
+                return samplesQueued ? TS_OK_NOT_MODIFIED : TS_ERR_SETFIELD_NOT_CALLED;
             }
             
-            if(!isnan(this->nextWriteLatitude)){
-                contentLen = contentLen + 5 + String(this->nextWriteLatitude).length(); // &lat=[value]
-            }
             
-            if(!isnan(this->nextWriteLongitude)){
-                contentLen = contentLen + 6 + String(this->nextWriteLongitude).length(); // &long=[value]
-            }
+            /*
+            Function: getQueuedCount
             
-            if(!isnan(this->nextWriteElevation)){
-                contentLen = contentLen + 11 + String(this->nextWriteElevation).length(); // &elevation=[value]
-            }
+            Summary:
+            Get the number of samples in the sample queue.
             
-            if(this->nextWriteStatus.length() > 0){
-                contentLen = contentLen + 8 + this->nextWriteStatus.length();	// &status=[value]
-            }
+            Parameters:
+            priority - TS_PRIORITY_ROUTINE or TS_PRIORITY_ALARM.  Omit to count the samples of all priorities.
             
-            if(this->nextWriteCreatedAt.length() > 0){
-                contentLen = contentLen + 12 + this->nextWriteCreatedAt.length();	// &created_at=[value]
+            Returns:
+            Number of samples queued by queueFields() and not yet written by writeQueuedFields().
+            */
+            unsigned int getQueuedCount()
+            {
+                unsigned int count = 0;
+                for(size_t priority = 0; priority < TS_PRIORITY_LEVELS; priority++)
+                {
+                    count += getQueuedCount(priority);
+                }
+                return count;
             }
             
-            if(contentLen == 0){
-                return 0;
+            unsigned int getQueuedCount(unsigned int priority)
+            {
+                if(priority >= TS_PRIORITY_LEVELS || NULL == this->queues[priority].buffer) return 0;
+                return this->queues[priority].header.count;
             }
             
-            contentLen = contentLen + 13; // add 14 for '&headers=false', subtract 1 for missing first '&'
             
-            return contentLen;
-        }
-        
-        void emptyStream(){
-            while(this->client->available() > 0){
-                this->client->read();
-            }
-        }
-        
-        int finishWrite(){
-            String entryIDText = String();
-            int status = getHTTPResponse(entryIDText);
+            /*
+            Function: getQueueDropped
             
-            emptyStream();
+            Summary:
+            Get the number of samples overwritten because the sample queue was full.
             
-            if(status != TS_OK_SUCCESS)
+            Parameters:
+            priority - TS_PRIORITY_ROUTINE or TS_PRIORITY_ALARM.  Omit to count the samples of all priorities.
+            
+            Returns:
+            Number of samples dropped since the queue was created.  The count stops at 65535.
+            */
+            unsigned int getQueueDropped()
             {
-                this->client->stop();
-                return status;
+                unsigned long dropped = 0;
+                for(size_t priority = 0; priority < TS_PRIORITY_LEVELS; priority++)
+                {
+                    dropped += getQueueDropped(priority);
+                }
+                return (dropped < UINT16_MAX) ? dropped : UINT16_MAX;
             }
-            long entryID = entryIDText.toInt();
-
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("               Entry ID \"");Serial.print(entryIDText);Serial.print("\" (");Serial.print(entryID);Serial.println(")");
-            #endif
             
-            this->client->stop();
+            unsigned int getQueueDropped(unsigned int priority)
+            {
+                if(priority >= TS_PRIORITY_LEVELS || NULL == this->queues[priority].buffer) return 0;
+                return this->queues[priority].header.dropped;
+            }
             
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.println("disconnected.");
-            #endif
-            if(entryID == 0)
+        #endif
+        
+         
+        /*
+        Function: readStringField
+        
+        Summary:
+        Read the latest string from a private ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+        field - Field number (1-8) within the channel to read from.
+        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        
+        Returns:
+        Value read (UTF8 string), or empty string if there is an error.  Use getLastReadStatus() to get more specific information.
+        */
+        String readStringField(unsigned long channelNumber, unsigned int field, const char * readAPIKey)
+        {
+            if(field < FIELDNUM_MIN || field > FIELDNUM_MAX)
             {
-                // ThingSpeak did not accept the write
-                status = TS_ERR_NOT_INSERTED;
+                this->lastReadStatus = TS_ERR_INVALID_FIELD_NUM;
+                return("");
             }
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("ts::readStringField(channelNumber: ")); Serial.print(channelNumber);
+                if(NULL != readAPIKey)
+                {
+                    Serial.print(F(" readAPIKey: ")); Serial.print(readAPIKey);
+                }
+                Serial.print(F(" field: ")); Serial.print(field); Serial.println(F(")"));
+            #endif
+            #ifndef ARDUINO_AVR_UNO
+                if(this->readCacheTTL > 0)
+                {
+                    if(refreshReadCache(channelNumber, readAPIKey) != TS_OK_SUCCESS) return String("");
+                    return this->cachedFeed.nextReadField[field - 1];
+                }
+            #endif
+            String suffixURL = String(F("/fields/"));
+            suffixURL.concat(field);
+            suffixURL.concat(F("/last"));
             
-            return status;
+            return readRaw(channelNumber, suffixURL, readAPIKey);
+        }
+
+
+        /*
+        Function: readStringField
+        
+        Summary:
+        Read the latest string from a public ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+        field - Field number (1-8) within the channel to read from.
+        
+        Returns:
+        Value read (UTF8 string), or empty string if there is an error.  Use getLastReadStatus() to get more specific information.
+        */
+        String readStringField(unsigned long channelNumber, unsigned int field)
+        {
+            return readStringField(channelNumber, field, NULL);
         }
+
+         
+        /*
+        Function: readStringField
+        
+        Summary:
+        Read the latest string from a private ThingSpeak channel into a caller-supplied buffer
+        
+        Parameters:
+        channelNumber - Channel number
+        field - Field number (1-8) within the channel to read from.
+        buf - Buffer that receives the value read (UTF8 string, zero terminated).
+        cap - Size of buf in bytes, including room for the terminator.
+        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
         
-        String getJSONValueByKey(String textToSearch, String key)
+        Returns:
+        Number of bytes copied into buf (not counting the terminator) if successful.  Otherwise a negative value: a library error code, or the negated HTTP status code (e.g. -404).  Use getLastReadStatus() to get more specific information.
+        
+        Notes:
+        No String objects are created.  If the value does not fit, buf holds the truncated value and -101 is returned.
+        */
+        int readStringField(unsigned long channelNumber, unsigned int field, char * buf, size_t cap, const char * readAPIKey)
         {
-            if(textToSearch.length() == 0){
-                return String("");
+            if(field < FIELDNUM_MIN || field > FIELDNUM_MAX)
+            {
+                this->lastReadStatus = TS_ERR_INVALID_FIELD_NUM;
+                return TS_ERR_INVALID_FIELD_NUM;
             }
+            #ifndef ARDUINO_AVR_UNO
+                if(this->readCacheTTL > 0)
+                {
+                    int status = refreshReadCache(channelNumber, readAPIKey);
+                    if(status != TS_OK_SUCCESS) return (status > 0) ? -status : status;
+                    return copyToBuffer(this->cachedFeed.nextReadField[field - 1], buf, cap);
+                }
+            #endif
+            
+            char suffixURL[16]; // "/fields/" + up to 3 digits + "/last" + terminator
+            strcpy_P(suffixURL, PSTR("/fields/"));
+            utoa(field, suffixURL + strlen(suffixURL), 10);
+            strcat_P(suffixURL, PSTR("/last"));
+            
+            return readRaw(channelNumber, suffixURL, buf, cap, readAPIKey);
+        }
+
+
+        /*
+        Function: readStringField
+        
+        Summary:
+        Read the latest string from a public ThingSpeak channel into a caller-supplied buffer
+        
+        Parameters:
+        channelNumber - Channel number
+        field - Field number (1-8) within the channel to read from.
+        buf - Buffer that receives the value read (UTF8 string, zero terminated).
+        cap - Size of buf in bytes, including room for the terminator.
+        
+        Returns:
+        Number of bytes copied into buf (not counting the terminator) if successful.  Otherwise a negative value: a library error code, or the negated HTTP status code (e.g. -404).  Use getLastReadStatus() to get more specific information.
+        */
+        int readStringField(unsigned long channelNumber, unsigned int field, char * buf, size_t cap)
+        {
+            return readStringField(channelNumber, field, buf, cap, NULL);
+        }
+
+         
+        /*
+        Function: readFloatField
+        
+        Summary:
+        ead the latest floating point value from a private ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+        field - Field number (1-8) within the channel to read from.
+        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        
+        Returns:
+        Value read, or 0 if the field is text or there is an error.  Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
+        */
+        float readFloatField(unsigned long channelNumber, unsigned int field, const char * readAPIKey)
+        {
+            char valueString[TS_NUMBER_LENGTH_MAX + 1];
+            if(!readNumberField(channelNumber, field, valueString, sizeof(valueString), readAPIKey)) return 0;
+            
+            return convertCharToFloat(valueString);
+        }
+
+        
+        /*
+        Function: readFloatField
+        
+        Summary:
+        Read the latest floating point value from a public ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+        field - Field number (1-8) within the channel to read from.
+        
+        Returns:
+        Value read, or 0 if the field is text or there is an error.  Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
+        */
+        float readFloatField(unsigned long channelNumber, unsigned int field)
+        {
+            return readFloatField(channelNumber, field, NULL);
+        }
+
+         
+        /*
+        Function: readLongField
+        
+        Summary:
+        Read the latest long value from a private ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+        field - Field number (1-8) within the channel to read from.
+        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        
+        Returns:
+        Value read, or 0 if the field is text or there is an error.  Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
+        */
+        long readLongField(unsigned long channelNumber, unsigned int field, const char * readAPIKey)
+        {
+            char valueString[TS_NUMBER_LENGTH_MAX + 1];
+            if(!readNumberField(channelNumber, field, valueString, sizeof(valueString), readAPIKey)) return 0;
+            
+            return convertCharToLong(valueString);
+        }
+
+         
+        /*
+        Function: readLongField
+        
+        Summary:
+        Read the latest long value from a public ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+        field - Field number (1-8) within the channel to read from.
+        
+        Returns:
+        Value read, or 0 if the field is text or there is an error.  Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
+        */
+        long readLongField(unsigned long channelNumber, unsigned int field)
+        {
+            return readLongField(channelNumber, field, NULL);
+        }
+
+         
+        /*
+        Function: readIntField
+        
+        Summary:
+        Read the latest int value from a private ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+        field - Field number (1-8) within the channel to read from.
+        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        
+        Returns:
+        Value read, or 0 if the field is text or there is an error.  Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
+        */
+        int readIntField(unsigned long channelNumber, unsigned int field, const char * readAPIKey)
+        {
+            return readLongField(channelNumber, field, readAPIKey);
+        }
+
+         
+        /*
+        Function: readIntField
+        
+        Summary:
+        Read the latest int value from a public ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+        field - Field number (1-8) within the channel to read from.
+        
+        Returns:
+        Value read, or 0 if the field is text or there is an error.  Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
+        */
+        int readIntField(unsigned long channelNumber, unsigned int field)
+        {
+            return readLongField(channelNumber, field, NULL);
+        }
+
+
+        /*
+        Function: readStatus
+        
+        Summary:
+        Read the latest status from a private ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        
+        Results:
+        Value read (UTF8 string). An empty string is returned if there was no status written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+        */
+        String readStatus(unsigned long channelNumber, const char * readAPIKey)
+        {
+            #ifndef ARDUINO_AVR_UNO
+                if(this->readCacheTTL > 0)
+                {
+                    if(refreshReadCache(channelNumber, readAPIKey) != TS_OK_SUCCESS) return String("");
+                    return this->cachedFeed.nextReadStatus;
+                }
+            #endif
+            String content = readRaw(channelNumber, String(F("/feeds/last.txt?status=true")), readAPIKey);
             
-            String searchPhrase = String("\"");
-            searchPhrase.concat(key);
-            searchPhrase.concat("\":\"");
+            if(getLastReadStatus() != TS_OK_SUCCESS){
+                return String("");
+            }
             
-            int fromPosition = textToSearch.indexOf(searchPhrase,0);
+            return getJSONValueByKey(content, F("status"));
+        }
+        
+         
+        /*
+        Function: readStatus
+        
+        Summary:
+        Read the latest status from a public ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+        
+        Results:
+        Value read (UTF8 string). An empty string is returned if there was no status written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+        */
+        String readStatus(unsigned long channelNumber)
+        {
+            return readStatus(channelNumber, NULL);
+        }
+        
+
+        /*
+        Function: readCreatedAt
+        
+        Summary:
+        Read the created-at timestamp associated with the latest update to a private ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        
+        Results:
+        Value read (UTF8 string). An empty string is returned if there was no created-at timestamp written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+        */
+        String readCreatedAt(unsigned long channelNumber, const char * readAPIKey)
+        {
+            #ifndef ARDUINO_AVR_UNO
+                if(this->readCacheTTL > 0)
+                {
+                    if(refreshReadCache(channelNumber, readAPIKey) != TS_OK_SUCCESS) return String("");
+                    return this->cachedFeed.nextReadCreatedAt;
+                }
+            #endif
+            String content = readRaw(channelNumber, String(F("/feeds/last.txt")), readAPIKey);
             
-            if(fromPosition == -1){
-                // return because there is no status or it's null
+            if(getLastReadStatus() != TS_OK_SUCCESS){
                 return String("");
             }
-            
-            fromPosition = fromPosition + searchPhrase.length();
-                    
-            int toPosition = textToSearch.indexOf("\"", fromPosition);
-            
-            
-            if(toPosition == -1){
-                // return because there is no end quote
-                return String("");
+            
+            return getJSONValueByKey(content, F("created_at"));
+        }
+
+        
+        /*
+        Function: readCreatedAt
+        
+        Summary:
+        Read the created-at timestamp associated with the latest update to a public ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+            
+        Results:
+        Value read (UTF8 string). An empty string is returned if there was no created-at timestamp written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+        */
+        String readCreatedAt(unsigned long channelNumber)
+        {
+            return readCreatedAt(channelNumber, NULL);
+        }
+           
+            
+        /*
+        Function: readRaw
+        
+        Summary:
+        Read a raw response from a private ThingSpeak channel
+        
+        Parameters:
+        channelNumber - Channel number
+        suffixURL - Raw URL to write to ThingSpeak as a String.  See the documentation at https://thingspeak.com/docs/channels#get_feed
+        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        
+        Returns:
+        Response if successful, or empty string. Use getLastReadStatus() to get more specific information.
+        
+        Notes:
+        This is low level functionality that will not be required by most users.
+        */
+        String readRaw(unsigned long channelNumber, String suffixURL, const char * readAPIKey)
+        {
+            #ifdef TS_MEMORY_STATS
+                memoryScope scope(this, TS_MEMORY_READ_RAW, __builtin_frame_address(0));
+            #endif
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("ts::readRaw   (channelNumber: ")); Serial.print(channelNumber);
+                if(NULL != readAPIKey)
+                {
+                    Serial.print(F(" readAPIKey: ")); Serial.print(readAPIKey);
+                }
+                Serial.print(F(" suffixURL: \"")); Serial.print(suffixURL); Serial.println(F("\")"));
+            #endif
+
+            String content = requestRaw(channelNumber, suffixURL.c_str(), readAPIKey);
+            #ifndef ARDUINO_AVR_UNO
+                if(staleConnectionFailed(this->lastReadStatus)) content = requestRaw(channelNumber, suffixURL.c_str(), readAPIKey);
+            #endif
+            
+            return content;
+        }
+        
+        
+        /*
+        Function: readRaw
+           
+        Summary:
+        Read a raw response from a public ThingSpeak channel
+           
+        Parameters:
+        channelNumber - Channel number
+        suffixURL - Raw URL to write to ThingSpeak as a String.  See the documentation at https://thingspeak.com/docs/channels#get_feed
+           
+        Returns:
+        Response if successful, or empty string. Use getLastReadStatus() to get more specific information.
+           
+        Notes:
+        This is low level functionality that will not be required by most users.
+        */
+        String readRaw(unsigned long channelNumber, String suffixURL)
+        {
+            return readRaw(channelNumber, suffixURL, NULL);
+        }
+        
+        
+        /*
+        Function: readRaw
+        
+        Summary:
+        Read a raw response from a private ThingSpeak channel into a caller-supplied buffer
+        
+        Parameters:
+        channelNumber - Channel number
+        suffixURL - Raw URL to read from ThingSpeak (zero terminated).  See the documentation at https://thingspeak.com/docs/channels#get_feed
+        buf - Buffer that receives the response body (zero terminated).
+        cap - Size of buf in bytes, including room for the terminator.
+        readAPIKey - Read API key associated with the channel.  *If you share code with others, do _not_ share this key*
+        
+        Returns:
+        Number of bytes copied into buf (not counting the terminator) if successful.  Otherwise a negative value: a library error code, or the negated HTTP status code (e.g. -404).  Use getLastReadStatus() to get more specific information.
+        
+        Notes:
+        This is low level functionality that will not be required by most users.
+        The request line is written directly from channelNumber and suffixURL, and no String objects are created.
+        If the response does not fit, buf holds the truncated response and -101 is returned.
+        */
+        int readRaw(unsigned long channelNumber, const char * suffixURL, char * buf, size_t cap, const char * readAPIKey)
+        {
+            #ifdef TS_MEMORY_STATS
+                memoryScope scope(this, TS_MEMORY_READ_RAW, __builtin_frame_address(0));
+            #endif
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("ts::readRaw   (channelNumber: ")); Serial.print(channelNumber);
+                if(NULL != readAPIKey)
+                {
+                    Serial.print(F(" readAPIKey: ")); Serial.print(readAPIKey);
+                }
+                Serial.print(F(" suffixURL: \"")); Serial.print(suffixURL); Serial.print(F("\" cap: ")); Serial.print(cap); Serial.println(F(")"));
+            #endif
+            
+            if(NULL == buf || 0 == cap)
+            {
+                this->lastReadStatus = TS_ERR_OUT_OF_RANGE;
+                return TS_ERR_OUT_OF_RANGE;
+            }
+            buf[0] = '\0';
+
+            int result = requestRaw(channelNumber, suffixURL, buf, cap, readAPIKey);
+            #ifndef ARDUINO_AVR_UNO
+                if(staleConnectionFailed(result)) result = requestRaw(channelNumber, suffixURL, buf, cap, readAPIKey);
+            #endif
+            
+            return result;
+        }
+        
+        
+        /*
+        Function: readRaw
+        
+        Summary:
+        Read a raw response from a public ThingSpeak channel into a caller-supplied buffer
+        
+        Parameters:
+        channelNumber - Channel number
+        suffixURL - Raw URL to read from ThingSpeak (zero terminated).  See the documentation at https://thingspeak.com/docs/channels#get_feed
+        buf - Buffer that receives the response body (zero terminated).
+        cap - Size of buf in bytes, including room for the terminator.
+        
+        Returns:
+        Number of bytes copied into buf (not counting the terminator) if successful.  Otherwise a negative value: a library error code, or the negated HTTP status code (e.g. -404).  Use getLastReadStatus() to get more specific information.
+        
+        Notes:
+        This is low level functionality that will not be required by most users.
+        */
+        int readRaw(unsigned long channelNumber, const char * suffixURL, char * buf, size_t cap)
+        {
+            return readRaw(channelNumber, suffixURL, buf, cap, NULL);
+        }
+        
+        
+        #ifndef ARDUINO_AVR_UNO // Arduino Uno doesn't have enough memory to perform the following functionalities.
+            
+            /*
+            Function: readMultipleFields
+             
+            Summary:
+            Read all the field values, status message, location coordinates, and created-at timestamp associated with the latest feed to a private ThingSpeak channel and store the values locally in variables within a struct.
+             
+            Parameters:
+            channelNumber - Channel number
+            readAPIKey - Read API key associated with the channel. *If you share code with others, do _not_ share this key*
+             
+            Returns:
+            HTTP status code of 200 if successful.
+            
+            Notes:
+            See getLastReadStatus() for other possible return values.
+            */
+            int readMultipleFields(unsigned long channelNumber, const char * readAPIKey)
+            {
+                #ifdef TS_MEMORY_STATS
+                    memoryScope scope(this, TS_MEMORY_READ_MULTIPLE, __builtin_frame_address(0));
+                #endif
+                if(this->readCacheTTL > 0)
+                {
+                    int status = refreshReadCache(channelNumber, readAPIKey);
+                    if(status == TS_OK_SUCCESS)
+                    {
+                        this->lastFeed = this->cachedFeed;
+                    }
+                    return status;
+                }
+                
+                String readCondition = String(F("/feeds/last.txt?status=true&location=true"));
+                
+                String multiContent = readRaw(channelNumber, readCondition, readAPIKey);
+                
+                if(getLastReadStatus() != TS_OK_SUCCESS){
+                    return getLastReadStatus();
+                }
+                
+                parseFeed(multiContent, this->lastFeed);
+                
+                return TS_OK_SUCCESS;
+            }
+            
+            
+            /*
+            Function: readMultipleFields
+            
+            Summary:
+            Read all the field values, status message, location coordinates, and created-at timestamp associated with the latest update to a private ThingSpeak channel and store the values locally in variables within a struct.
+             
+            Parameters:
+            channelNumber - Channel number
+            readAPIKey - Read API key associated with the channel. *If you share code with others, do _not_ share this key*
+             
+            Returns:
+            HTTP status code of 200 if successful.
+            
+            Notes:
+            See getLastReadStatus() for other possible return values.
+            */
+            int readMultipleFields(unsigned long channelNumber)
+            {
+                return readMultipleFields(channelNumber, NULL);
+            }
+            
+            
+            /*
+            Function: getFieldAsString
+             
+            Summary:
+            Fetch the value as string from the latest stored feed record.
+            
+            Parameters:
+            field - Field number (1-8) within the channel to read from.
+            
+            Returns:
+            Value read (UTF8 string), empty string if there is an error, or old value read (UTF8 string) if invoked before readMultipleFields().  Use getLastReadStatus() to get more specific information.
+            */
+            String getFieldAsString(unsigned int field)
+            {
+                if(field < FIELDNUM_MIN || field > FIELDNUM_MAX)
+                {
+                    this->lastReadStatus = TS_ERR_INVALID_FIELD_NUM;
+                    return("");
+                }
+                
+                this->lastReadStatus = TS_OK_SUCCESS;
+                return this->lastFeed.nextReadField[field-1];
+            }
+            
+            
+            /*
+            Function: getFieldAsFloat
+             
+            Summary:
+            Fetch the value as float from the latest stored feed record.
+            
+            Parameters:
+            field - Field number (1-8) within the channel to read from.
+            
+            Returns:
+            Value read, 0 if the field is text or there is an error, or old value read if invoked before readMultipleFields(). Use getLastReadStatus() to get more specific information.  Note that NAN, INFINITY, and -INFINITY are valid results.
+            */
+            float getFieldAsFloat(unsigned int field)
+            {
+                return convertCharToFloat(getFieldAsString(field).c_str());
+            }
+            
+            
+            /*
+            Function: getFieldAsLong
+            
+            Summary:
+            Fetch the value as long from the latest stored feed record.
+            
+            Parameters:
+            field - Field number (1-8) within the channel to read from.
+            
+            Returns:
+            Value read, 0 if the field is text or there is an error, or old value read if invoked before readMultipleFields(). Use getLastReadStatus() to get more specific information.
+            */
+            long getFieldAsLong(unsigned int field)
+            {
+                return convertCharToLong(getFieldAsString(field).c_str());
+            }
+            
+            
+            /*
+            Function: getFieldAsInt
+             
+            Summary:
+            Fetch the value as int from the latest stored feed record.
+            
+            Parameters:
+            field - Field number (1-8) within the channel to read from.
+            
+            Returns:
+            Value read, 0 if the field is text or there is an error, or old value read if invoked before readMultipleFields(). Use getLastReadStatus() to get more specific information.
+            */
+            int getFieldAsInt(unsigned int field)
+            {
+                // int and long are same
+                return getFieldAsLong(field);
+            }
+            
+                
+            /*
+            Function: getStatus
+             
+            Summary:
+            Fetch the status message associated with the latest stored feed record.
+            
+            Results:
+            Value read (UTF8 string). An empty string is returned if there was no status written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+            */
+            String getStatus()
+            {
+                return this->lastFeed.nextReadStatus;
+            }
+            
+            
+            /*
+            Function: getLatitude
+             
+            Summary:
+            Fetch the latitude associated with the latest stored feed record.
+            
+            Results:
+            Value read (UTF8 string). An empty string is returned if there was no latitude written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+            */
+            String getLatitude()
+            {
+                return this->lastFeed.nextReadLatitude;
+            }
+            
+            
+            /*
+            Function: getLongitude
+             
+            Summary:
+            Fetch the longitude associated with the latest stored feed record.
+            
+            Results:
+            Value read (UTF8 string). An empty string is returned if there was no longitude written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+            */
+            String getLongitude()
+            {
+                return this->lastFeed.nextReadLongitude;
+            }
+            
+            
+            /*
+            Function: getElevation
+             
+            Summary:
+            Fetch the longitude associated with the latest stored feed record.
+            
+            Results:
+            Value read (UTF8 string). An empty string is returned if there was no elevation written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+            */
+            String getElevation()
+            {
+                return this->lastFeed.nextReadElevation;
+            }
+            
+            
+            /*
+            Function: getCreatedAt
+             
+            Summary:
+            Fetch the created-at timestamp associated with the latest stored feed record.
+            
+            Results:
+            Value read (UTF8 string). An empty string is returned if there was no created-at timestamp written to the channel or in case of an error.  Use getLastReadStatus() to get more specific information.
+            */
+            String getCreatedAt()
+            {
+                return this->lastFeed.nextReadCreatedAt;
+            }
+            
+            
+            /*
+            Function: readFeedRange
+             
+            Summary:
+            Read the entries of a private ThingSpeak channel in a time range, one row at a time, without holding the response in memory.
+             
+            Parameters:
+            channelNumber - Channel number
+            startTime - Start of the range in seconds since 1970-01-01 UTC.
+            endTime - End of the range in seconds since 1970-01-01 UTC.
+            rowCallback - Function called for every entry, with its created-at time, entry ID and field values.  Fields that are empty or not numeric are NaN.
+            readAPIKey - Read API key associated with the channel. *If you share code with others, do _not_ share this key*
+             
+            Returns:
+            Number of entries read, or a negative error code.  HTTP errors are returned negated, e.g. -404.
+            
+            Notes:
+            ThingSpeak returns at most TS_FEED_RESULTS_MAX (8000) entries per request.  If that many are read, read the rest of the range starting after the time of the last row.
+            This feature not available in Arduino Uno due to memory constraints.
+            */
+            int readFeedRange(unsigned long channelNumber, unsigned long startTime, unsigned long endTime, void (*rowCallback)(const feedRow & row), const char * readAPIKey)
+            {
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("ts::readFeedRange (channelNumber: ")); Serial.print(channelNumber); Serial.print(F(" startTime: ")); Serial.print(startTime); Serial.print(F(" endTime: ")); Serial.print(endTime); Serial.println(F(")"));
+                #endif
+                
+                if(NULL == rowCallback || endTime < startTime)
+                {
+                    this->lastReadStatus = TS_ERR_OUT_OF_RANGE;
+                    return TS_ERR_OUT_OF_RANGE;
+                }
+                
+                // /feeds.csv?start=YYYY-MM-DD%20HH:MM:SS&end=YYYY-MM-DD%20HH:MM:SS&results=8000&timezone=UTC
+                char suffixURL[96];
+                strcpy_P(suffixURL, PSTR("/feeds.csv?start="));
+                formatQueryTime(startTime, suffixURL + strlen(suffixURL));
+                strcat_P(suffixURL, PSTR("&end="));
+                formatQueryTime(endTime, suffixURL + strlen(suffixURL));
+                strcat_P(suffixURL, PSTR("&results="));
+                ltoa(TS_FEED_RESULTS_MAX, suffixURL + strlen(suffixURL), 10);
+                strcat_P(suffixURL, PSTR("&timezone=UTC"));
+                
+                int rows = requestFeedRange(channelNumber, suffixURL, rowCallback, readAPIKey);
+                if(staleConnectionFailed(rows)) rows = requestFeedRange(channelNumber, suffixURL, rowCallback, readAPIKey);
+                
+                return rows;
+            }
+            
+            
+            /*
+            Function: readFeedRange
+             
+            Summary:
+            Read the entries of a public ThingSpeak channel in a time range, one row at a time, without holding the response in memory.
+             
+            Parameters:
+            channelNumber - Channel number
+            startTime - Start of the range in seconds since 1970-01-01 UTC.
+            endTime - End of the range in seconds since 1970-01-01 UTC.
+            rowCallback - Function called for every entry, with its created-at time, entry ID and field values.  Fields that are empty or not numeric are NaN.
+             
+            Returns:
+            Number of entries read, or a negative error code.  HTTP errors are returned negated, e.g. -404.
+            */
+            int readFeedRange(unsigned long channelNumber, unsigned long startTime, unsigned long endTime, void (*rowCallback)(const feedRow & row))
+            {
+                return readFeedRange(channelNumber, startTime, endTime, rowCallback, NULL);
+            }
+            
+            
+            /*
+            Function: setReadCacheTTL
+             
+            Summary:
+            Serve repeated reads of the latest feed of a channel from a single request.
+            
+            Parameters:
+            ttlMs - Time in milliseconds a fetched feed record stays valid.  0 (the default) disables the cache.
+            
+            Returns:
+            Always returns 200
+            
+            Notes:
+            While enabled, the first call to readStringField(), readFloatField(), readLongField(), readIntField(), readStatus(), readCreatedAt() or readMultipleFields() fetches the complete latest feed of the channel once.
+            Later reads of the same channel within ttlMs are answered from the stored record without connecting to ThingSpeak.
+            Writing to the cached channel, reading another channel, or calling this function discards the stored record.
+            */
+            int setReadCacheTTL(unsigned long ttlMs)
+            {
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("ts::setReadCacheTTL(ttlMs: ")); Serial.print(ttlMs); Serial.println(F(")"));
+                #endif
+                this->readCacheTTL = ttlMs;
+                this->readCacheValid = false;
+                
+                return TS_OK_SUCCESS;
+            }
+            
+            
+            /*
+            Function: pollChannel
+             
+            Summary:
+            Check a private ThingSpeak channel for a new entry, and fetch it only if it changed since the last poll.
+            
+            Parameters:
+            channelNumber - Channel number
+            readAPIKey - Read API key associated with the channel. *If you share code with others, do _not_ share this key*
+            
+            Returns:
+            200 - a new entry was found; its values are stored and can be fetched with getFieldAsString() and the other getField functions.
+            304 - the channel has no new entry, or the poll is not due yet (see getPollInterval()).  No fields are parsed and the callback is not invoked.
+            See getLastReadStatus() for other possible return values.
+            
+            Notes:
+            Call this as often as you like, e.g. on every loop(); the channel is only contacted once its poll interval elapsed.
+            The entry_id of the latest entry is remembered per channel; if it didn't change, the connection is closed without downloading the rest of the entry.  The interval adapts to the observed update cadence of the channel, within the bounds set by setPollInterval().
+            This feature not available in Arduino Uno due to memory constraints.
+            */
+            int pollChannel(unsigned long channelNumber, const char * readAPIKey)
+            {
+                pollState * state = getPollState(channelNumber);
+                unsigned long now = TS_MILLIS();
+                
+                if(state->polled && (now - state->lastPollTime) < state->interval)
+                {
+                    return TS_OK_NOT_MODIFIED;
+                }
+                state->polled = true;
+                state->lastPollTime = now;
+                
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("ts::pollChannel(channelNumber: ")); Serial.print(channelNumber); Serial.print(F(" lastEntryID: ")); Serial.print(state->lastEntryID); Serial.println(F(")"));
+                #endif
+                
+                long entryID = 0;
+                int status = probeLatestEntry(channelNumber, readAPIKey, state->lastEntryID, entryID);
+                this->lastReadStatus = (status == TS_OK_NOT_MODIFIED) ? TS_OK_SUCCESS : status;
+                
+                if(status == TS_OK_NOT_MODIFIED)
+                {
+                    // Back off while nothing changes
+                    state->interval = min(state->interval + state->interval / 2, this->pollIntervalMax);
+                    return TS_OK_NOT_MODIFIED;
+                }
+                if(status != TS_OK_SUCCESS)
+                {
+                    return status;
+                }
+                
+                // Poll at twice the rate the channel is observed to update
+                if(0 != state->lastEntryID)
+                {
+                    unsigned long observed = now - state->lastChangeTime;
+                    state->cadence = (0 == state->cadence) ? observed : (3 * (state->cadence / 4) + observed / 4);
+                    state->interval = constrain(state->cadence / 2, this->pollIntervalMin, this->pollIntervalMax);
+                }
+                state->lastChangeTime = now;
+                state->lastEntryID = entryID;
+                
+                if(NULL != this->feedChangedCallback)
+                {
+                    this->feedChangedCallback(channelNumber);
+                }
+                
+                return TS_OK_SUCCESS;
+            }
+            
+            
+            /*
+            Function: pollChannel
+             
+            Summary:
+            Check a public ThingSpeak channel for a new entry, and fetch it only if it changed since the last poll.
+            
+            Parameters:
+            channelNumber - Channel number
+            
+            Returns:
+            200 - a new entry was found; its values are stored and can be fetched with getFieldAsString() and the other getField functions.
+            304 - the channel has no new entry, or the poll is not due yet (see getPollInterval()).
+            See getLastReadStatus() for other possible return values.
+            */
+            int pollChannel(unsigned long channelNumber)
+            {
+                return pollChannel(channelNumber, NULL);
+            }
+            
+            
+            /*
+            Function: setPollInterval
+             
+            Summary:
+            Set the bounds of the adaptive interval used by pollChannel().
+            
+            Parameters:
+            minIntervalMs - Shortest time in milliseconds between two polls of a channel (default 15000).
+            maxIntervalMs - Longest time in milliseconds between two polls of a channel (default 300000).
+            
+            Returns:
+            Code of 200 if successful.
+            Code of -101 if minIntervalMs is 0 or larger than maxIntervalMs.
+            */
+            int setPollInterval(unsigned long minIntervalMs, unsigned long maxIntervalMs)
+            {
+                if(0 == minIntervalMs || minIntervalMs > maxIntervalMs) return TS_ERR_OUT_OF_RANGE;
+                
+                this->pollIntervalMin = minIntervalMs;
+                this->pollIntervalMax = maxIntervalMs;
+                for(size_t i = 0; i < TS_POLL_CHANNELS_MAX; i++)
+                {
+                    this->pollStates[i].interval = constrain(this->pollStates[i].interval, minIntervalMs, maxIntervalMs);
+                }
+                
+                return TS_OK_SUCCESS;
+            }
+            
+            
+            /*
+            Function: getPollInterval
+             
+            Summary:
+            Get the current adaptive poll interval of a channel.
+            
+            Parameters:
+            channelNumber - Channel number
+            
+            Returns:
+            Time in milliseconds pollChannel() waits between two polls of the channel.
+            */
+            unsigned long getPollInterval(unsigned long channelNumber)
+            {
+                for(size_t i = 0; i < TS_POLL_CHANNELS_MAX; i++)
+                {
+                    if(this->pollStates[i].polled && this->pollStates[i].channelNumber == channelNumber) return this->pollStates[i].interval;
+                }
+                return this->pollIntervalMin;
+            }
+            
+            
+            /*
+            Function: setFeedChangedCallback
+             
+            Summary:
+            Register a function that pollChannel() calls when a channel has a new entry.
+            
+            Parameters:
+            callback - Function taking the channel number, or NULL to remove the callback.  Fetch the new values with getFieldAsString() and the other getField functions.
+            
+            Returns:
+            Always returns 200
+            */
+            int setFeedChangedCallback(void (*callback)(unsigned long channelNumber))
+            {
+                this->feedChangedCallback = callback;
+                
+                return TS_OK_SUCCESS;
+            }
+        
+        #endif
+        
+     
+        #ifndef ARDUINO_AVR_UNO
+            /*
+            Function: prepare
+            
+            Summary:
+            Open the connection to ThingSpeak now, so that the next write or read does not pay the connect (and HTTPS handshake) time.
+            
+            Returns:
+            Code of 200 if the connection is ready.
+            Code of -301 if the connection failed.
+            
+            Notes:
+            The next request uses the prepared connection if it is still open and was prepared less than 10 seconds earlier; otherwise it connects again as usual.  If the server has closed it meanwhile, the request is sent again on a new connection.
+            */
+            int prepare()
+            {
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.println(F("ts::prepare"));
+                #endif
+                if((this->connectionPrepared || this->connectionKept) && this->client->connected())
+                {
+                    return TS_OK_SUCCESS;
+                }
+                
+                this->connectionPrepared = false;
+                int connectStatus = openConnection();
+                if(connectStatus != TS_OK_SUCCESS)
+                {
+                    return connectStatus;
+                }
+                
+                this->connectionPrepared = true;
+                this->preparedTime = TS_MILLIS();
+                this->preparedConnectMs = this->lastConnectMs;
+                
+                return TS_OK_SUCCESS;
+            }
+            
+            
+            /*
+            Function: prepare
+            
+            Summary:
+            Open the connection to ThingSpeak ahead of a scheduled write, once the write is closer than the lead time set with setPrepareLeadTime().
+            
+            Parameters:
+            scheduledTime - Value of millis() at which the next write or read is due.
+            
+            Returns:
+            Code of 200 if the connection is ready.
+            Code of 304 if the scheduled time is still further away than the lead time.
+            Code of -301 if the connection failed.
+            
+            Notes:
+            Call this on every loop() iteration with the time of the next upload.
+            */
+            int prepare(unsigned long scheduledTime)
+            {
+                if((long)(scheduledTime - TS_MILLIS()) > (long)this->prepareLeadTime)
+                {
+                    return TS_OK_NOT_MODIFIED;
+                }
+                
+                return prepare();
+            }
+            
+            
+            /*
+            Function: setPrepareLeadTime
+            
+            Summary:
+            Set how long before a scheduled write prepare(scheduledTime) opens the connection.
+            
+            Parameters:
+            leadTimeMs - Lead time in milliseconds (default 3000).  Use a value that covers the connect time, including the HTTPS handshake.
+            
+            Returns:
+            Always returns 200
+            */
+            int setPrepareLeadTime(unsigned long leadTimeMs)
+            {
+                this->prepareLeadTime = leadTimeMs;
+                
+                return TS_OK_SUCCESS;
+            }
+        #endif
+        
+        
+        #ifndef ARDUINO_AVR_UNO
+            /*
+            Function: setSessionCache
+            
+            Summary:
+            Reuse the TLS session of the previous HTTPS connection, so that later connections skip most of the handshake.
+            
+            Parameters:
+            cache - Session cache for the client passed to begin(), or NULL to disable resumption.  For the ESP8266 BearSSL WiFiClientSecure use a ThingSpeakBearSSLSession; other clients can implement ThingSpeakSessionCache.
+            
+            Returns:
+            Always returns 200
+            
+            Notes:
+            Only used for HTTPS connections.  The cache object must remain valid while the library is used.
+            getConnectionStats() reports the connect time of full and resumed handshakes separately.
+            */
+            int setSessionCache(ThingSpeakSessionCache * cache)
+            {
+                this->sessionCache = cache;
+                
+                return TS_OK_SUCCESS;
+            }
+            
+        #endif
+        
+        
+        #ifndef ARDUINO_AVR_UNO
+            /*
+            Function: setCircuitBreaker
+            
+            Summary:
+            Fail fast instead of blocking in connect while the uplink is down.
+            
+            Parameters:
+            failureThreshold - Number of failed connects in a row that opens the circuit.  0 (the default) disables the circuit breaker.
+            backoffMs - Time in milliseconds the circuit stays open after it opened the first time.  It doubles each time a probe fails.
+            maxBackoffMs - Longest time in milliseconds the circuit stays open.
+            
+            Returns:
+            Code of 200 if successful.
+            Code of -101 if backoffMs is 0 or larger than maxBackoffMs.  The backoff is not checked when failureThreshold is 0.
+            
+            Notes:
+            While the circuit is open, writes and reads return -305 right away without connecting.  Once the backoff elapsed (plus up to 25% random jitter), the next request probes the connection: success closes the circuit, failure opens it again.
+            Use getCircuitState() and getConnectionStats() to adapt the sampling rate.
+            */
+            int setCircuitBreaker(unsigned int failureThreshold, unsigned long backoffMs, unsigned long maxBackoffMs)
+            {
+                // The backoff only matters while the breaker is enabled
+                if(0 != failureThreshold && (0 == backoffMs || backoffMs > maxBackoffMs)) return TS_ERR_OUT_OF_RANGE;
+                
+                this->circuitThreshold = failureThreshold;
+                this->circuitBackoffBase = backoffMs;
+                this->circuitBackoffMax = maxBackoffMs;
+                this->circuitFailures = 0;
+                this->circuitTrips = 0;
+                this->circuitState = TS_CIRCUIT_CLOSED;
+                
+                return TS_OK_SUCCESS;
+            }
+            
+            
+            /*
+            Function: getCircuitState
+            
+            Summary:
+            Get the state of the circuit breaker.
+            
+            Returns:
+            0 (TS_CIRCUIT_CLOSED) - connects are attempted normally.
+            1 (TS_CIRCUIT_OPEN) - connects fail fast until the backoff elapsed, see getCircuitRetryDelay().
+            2 (TS_CIRCUIT_HALF_OPEN) - the next connect probes whether the uplink is back.
+            */
+            int getCircuitState()
+            {
+                if(TS_CIRCUIT_OPEN == this->circuitState && (TS_MILLIS() - this->circuitOpenTime) >= this->circuitBackoff)
+                {
+                    return TS_CIRCUIT_HALF_OPEN;
+                }
+                
+                return this->circuitState;
+            }
+            
+            
+            /*
+            Function: getCircuitRetryDelay
+            
+            Summary:
+            Get the time until the circuit breaker lets the next connect through.
+            
+            Returns:
+            Time in milliseconds, or 0 if the circuit is not open.
+            */
+            unsigned long getCircuitRetryDelay()
+            {
+                if(TS_CIRCUIT_OPEN != getCircuitState())
+                {
+                    return 0;
+                }
+                
+                return this->circuitBackoff - (TS_MILLIS() - this->circuitOpenTime);
+            }
+        #endif
+        
+        
+        #ifndef ARDUINO_AVR_UNO
+            /*
+            Function: getConnectionStats
+            
+            Summary:
+            Get counters on connections opened by the library.
+            
+            Returns:
+            Struct with the number of connects and connect failures, the total connect time, and how often and by how much prepare() saved connect time.
+            */
+            const connectionStats & getConnectionStats()
+            {
+                return this->stats;
+            }
+            
+            
+            /*
+            Function: resetConnectionStats
+            
+            Summary:
+            Set all counters reported by getConnectionStats() to zero.
+            */
+            void resetConnectionStats()
+            {
+                memset(&this->stats, 0, sizeof(this->stats));
+            }
+        #endif
+        
+        
+        /*
+        Function: getFreeMemory
+        
+        Summary:
+        Get the memory available to the heap.
+        
+        Returns:
+        Free heap in bytes on ESP8266 and ESP32; free memory between heap and stack on AVR, SAMD and SAM boards.  -1 on other boards.
+        */
+        long getFreeMemory()
+        {
+            #if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
+                return ESP.getFreeHeap();
+            #elif defined(ARDUINO_ARCH_AVR)
+                char top;
+                return &top - (NULL != __brkval ? __brkval : &__heap_start);
+            #elif defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_SAM)
+                char top;
+                return &top - sbrk(0);
+            #else
+                return -1;
+            #endif
+        }
+        
+        
+        #ifdef TS_MEMORY_STATS
+            /*
+            Function: getMemoryStats
+            
+            Summary:
+            Get the memory use of a public call, measured since the last resetMemoryStats().
+            
+            Parameters:
+            call - TS_MEMORY_WRITE_FIELDS, TS_MEMORY_WRITE_RAW, TS_MEMORY_READ_RAW or TS_MEMORY_READ_MULTIPLE
+            
+            Returns:
+            Struct with the number of calls measured, the peak memory taken during a call, the least free memory seen, and the deepest stack use.
+            
+            Notes:
+            Only available when TS_MEMORY_STATS is defined before including ThingSpeak.h.  Memory is sampled where the library holds the most: after building a request and after reading or parsing a response, so short-lived peaks in between may be missed.
+            The heap is measured with getFreeMemory(), so peakUse and freeMin stay 0 on boards it doesn't support.
+            */
+            const memoryStats & getMemoryStats(unsigned int call)
+            {
+                return this->memoryCounters[(call < TS_MEMORY_CALLS) ? call : 0];
+            }
+            
+            
+            /*
+            Function: resetMemoryStats
+            
+            Summary:
+            Clear the memory use reported by getMemoryStats().
+            */
+            void resetMemoryStats()
+            {
+                memset(this->memoryCounters, 0, sizeof(this->memoryCounters));
+            }
+        #endif
+        
+        
+        #ifdef TS_TRACE
+            /*
+            Function: dumpTrace
+            
+            Summary:
+            Print the recorded trace events, oldest first, one per line: time in microseconds, event name and its two arguments.
+            
+            Parameters:
+            out - Where to print the events, e.g. Serial
+            
+            Notes:
+            Only available when TS_TRACE is defined before including ThingSpeak.h.  Events are recorded into a ring of TS_TRACE_EVENTS entries at a few instructions each, without printing, so that tracing doesn't change the timing it's meant to show.  Call this when the timing no longer matters, e.g. after the write cycle.
+            */
+            void dumpTrace(Print & out)
+            {
+                size_t index = (this->traceNext + TS_TRACE_EVENTS - this->traceCount) % TS_TRACE_EVENTS;
+                for(size_t iEvent = 0; iEvent < this->traceCount; iEvent++)
+                {
+                    const traceEntry & event = this->traceEvents[index];
+                    out.print(event.time);
+                    out.print(' ');
+                    out.print(getTraceEventName(event.id));
+                    out.print(' ');
+                    out.print(event.a);
+                    out.print(' ');
+                    out.println(event.b);
+                    if(++index == TS_TRACE_EVENTS) index = 0;
+                }
+            }
+            
+            
+            /*
+            Function: clearTrace
+            
+            Summary:
+            Discard the recorded trace events.
+            */
+            void clearTrace()
+            {
+                this->traceNext = 0;
+                this->traceCount = 0;
+            }
+        #endif
+        
+        
+        #ifndef ARDUINO_AVR_UNO
+            /*
+            Function: setKeepAlive
+            
+            Summary:
+            Keep the connection open after a successful request, and send the next request on it.
+            
+            Parameters:
+            idleMs - Longest time in milliseconds a connection is kept open without a request.  0 (the default) closes the connection after every request.
+            
+            Returns:
+            Always returns 200
+            
+            Notes:
+            A request within idleMs of the previous one saves the connect (and HTTPS handshake) time.  Keep idleMs below the idle timeout of the server; a request that finds the connection closed by the server is sent again on a new connection, which costs the time saved.
+            The connection is closed anyway after errors, and when the server answers with "Connection: close".
+            */
+            int setKeepAlive(unsigned long idleMs)
+            {
+                this->keepAliveIdle = idleMs;
+                if(0 == idleMs && this->connectionKept)
+                {
+                    this->connectionKept = false;
+                    this->client->stop();
+                }
+                
+                return TS_OK_SUCCESS;
+            }
+        #endif
+        
+        
+        #ifndef ARDUINO_AVR_UNO // Arduino Uno doesn't have enough memory to perform the following functionalities.
+        
+            /*
+            Function: setRateLimit
+            
+            Summary:
+            Hold back writes to a channel that come sooner than the rate limit of the ThingSpeak account allows.
+            
+            Parameters:
+            intervalMs - Shortest time in milliseconds between writes to the same channel, for example 15000 for a free account.  0 (the default) disables the limit.
+            
+            Returns:
+            Always returns 200
+            
+            Notes:
+            A write that comes too soon returns -401 without a request, as ThingSpeak would reject it anyway.  writeFields() then keeps the fields set, so values set until the next writeFields() are coalesced into one update.
+            The last write time is tracked for up to TS_RATE_LIMIT_CHANNELS_MAX channels.
+            This feature not available in Arduino Uno due to memory constraints.
+            */
+            int setRateLimit(unsigned long intervalMs)
+            {
+                this->rateLimitInterval = intervalMs;
+                
+                return TS_OK_SUCCESS;
+            }
+            
+            
+            /*
+            Function: getRateLimitDelay
+            
+            Summary:
+            Get the time until the rate limit set with setRateLimit() allows the next write to a channel.
+            
+            Parameters:
+            channelNumber - Channel number
+            
+            Returns:
+            Time in milliseconds, or 0 if a write is allowed now.
+            */
+            unsigned long getRateLimitDelay(unsigned long channelNumber)
+            {
+                for(size_t i = 0; i < TS_RATE_LIMIT_CHANNELS_MAX; i++)
+                {
+                    const rateLimit & limit = this->rateLimits[i];
+                    if(limit.written && limit.channelNumber == channelNumber)
+                    {
+                        unsigned long elapsed = TS_MILLIS() - limit.lastWriteTime;
+                        return elapsed < this->rateLimitInterval ? this->rateLimitInterval - elapsed : 0;
+                    }
+                }
+                return 0;
+            }
+            
+        #endif
+        
+     
+        /*
+        Function: getLastReadStatus
+        
+        Summary:
+        Get the status of the previous read.
+        
+        Returns:
+        Generally, these are HTTP status codes.  Negative values indicate an error generated by the library.
+        Possible response codes...
+        200 - OK / Success
+        404 - Incorrect API key (or invalid ThingSpeak server address)
+        -101 - Value is out of range or string is too long (> 255 characters)
+        -201 - Invalid field number specified
+        -210 - setField() was not called before writeFields()
+        -301 - Failed to connect to ThingSpeak
+        -302 -  Unexpected failure during write to ThingSpeak
+        -303 - Unable to parse response
+        -304 - Timeout waiting for server to respond
+        -401 - Point was not inserted (most probable cause is exceeding the rate limit)
+        
+        Notes:
+        The read functions will return zero or empty if there is an error.  Use this function to retrieve the details.
+        */
+        int getLastReadStatus()
+        {
+            return this->lastReadStatus;
+        }
+        
+        
+    private:
+            
+        bool serializeWriteFields(String & postMessage){
+            for(size_t iField = 0; iField < FIELDNUM_MAX; iField++){
+                if(this->nextWriteField[iField].length() > 0){
+                    postMessage.concat(F("&field"));
+                    postMessage.concat(iField + 1);
+                    postMessage.concat(F("="));
+                    postMessage.concat(this->nextWriteField[iField]);
+                }
+            }
+            
+            if(!isnan(this->nextWriteLatitude)){
+                postMessage.concat(F("&lat="));
+                postMessage.concat(this->nextWriteLatitude);
+            }
+            
+            if(!isnan(this->nextWriteLongitude)){
+                postMessage.concat(F("&long="));
+                postMessage.concat(this->nextWriteLongitude);
+            }
+            
+            if(!isnan(this->nextWriteElevation)){
+                postMessage.concat(F("&elevation="));
+                postMessage.concat(this->nextWriteElevation);
+            }
+            
+            if(this->nextWriteStatus.length() > 0){
+                postMessage.concat(F("&status="));
+                postMessage.concat(this->nextWriteStatus);
+            }
+            
+            if(postMessage.length() == 0){
+                return false;
+            }
+            
+            if(this->nextWriteCreatedAt.length() > 0){
+                postMessage.concat(F("&created_at="));
+                postMessage.concat(this->nextWriteCreatedAt);
+            }
+            else if(NULL != this->timeSource){
+                // A stable timestamp, so that a retry of this update can't land at a different time
+                unsigned long createdTime = this->timeSource();
+                if(0 != createdTime){
+                    char createdAt[TS_ISO8601_LENGTH];
+                    formatISO8601(createdTime, createdAt);
+                    postMessage.concat(F("&created_at="));
+                    postMessage.concat(createdAt);
+                }
+            }
+            
+            postMessage.concat(F("&headers=false"));
+            postMessage.remove(0, 1); // drop the leading '&'
+            
+            return true;
+        }
+        
+        int writeUpdate(unsigned long channelNumber, String & postMessage, const char * writeAPIKey)
+        {
+            #ifdef ARDUINO_AVR_UNO
+                int status = postUpdate(channelNumber, postMessage, writeAPIKey);
+                #ifdef TS_MEMORY_STATS
+                    sampleMemory();
+                #endif
+                
+                return status;
+            #else
+                this->pendingWrite = postMessage;
+                this->pendingWriteChannel = channelNumber;
+                this->pendingWriteAPIKey = writeAPIKey;
+                
+                return sendPendingWrite();
+            #endif
+        }
+        
+        #ifndef ARDUINO_AVR_UNO
+            int sendPendingWrite()
+            {
+                unsigned long retryStart = TS_MILLIS();
+                unsigned long backoff = this->retryBackoff;
+                int status;
+                
+                for(unsigned int attempt = 1; ; attempt++)
+                {
+                    status = postUpdate(this->pendingWriteChannel, this->pendingWrite, this->pendingWriteAPIKey);
+                    #ifdef TS_MEMORY_STATS
+                        sampleMemory();
+                    #endif
+                    
+                    if(!isRetryableWriteStatus(status) || attempt >= this->retryMaxAttempts)
+                    {
+                        break;
+                    }
+                    if((TS_MILLIS() - retryStart) + backoff > this->retryBudget)
+                    {
+                        break;
+                    }
+                    TS_TRACE_EVENT(TS_TRACE_RETRY, attempt, status);
+                    
+                    #ifdef PRINT_DEBUG_MESSAGES
+                        Serial.print(F("               Retry ")); Serial.print(attempt); Serial.print(F(" after ")); Serial.print(status); Serial.print(F(" in ")); Serial.print(backoff); Serial.println(F(" ms"));
+                    #endif
+                    TS_DELAY(backoff);
+                    backoff = backoff * 2;
+                }
+                
+                if(status == TS_OK_SUCCESS)
+                {
+                    this->pendingWrite = String();
+                    recordChannelWrite(this->pendingWriteChannel);
+                    commitDeadbandFields(this->pendingWriteDeadbandFields);
+                    this->pendingWriteDeadbandFields = 0;
+                }
+                
+                return status;
+            }
+            
+            bool isRetryableWriteStatus(int status)
+            {
+                return status == TS_ERR_CONNECT_FAILED || status == TS_ERR_UNEXPECTED_FAIL || status == TS_ERR_BAD_RESPONSE || status == TS_ERR_TIMEOUT || (status >= 500 && status < 600);
+            }
+        #endif
+        
+        #ifndef ARDUINO_AVR_UNO
+            int sendTemplate()
+            {
+                int connectStatus = connectThingSpeak();
+                if(connectStatus != TS_OK_SUCCESS)
+                {
+                    return connectStatus;
+                }
+                
+                TS_TRACE_EVENT(TS_TRACE_REQUEST, this->writeTemplateState.channelNumber, this->writeTemplateState.length);
+                if(this->client->write((const uint8_t *)this->writeTemplateState.buffer, this->writeTemplateState.length) != this->writeTemplateState.length) return abortWriteRaw();
+                
+                invalidateReadCache(this->writeTemplateState.channelNumber);
+                
+                return finishWrite();
+            }
+        #endif
+        
+        String requestRaw(unsigned long channelNumber, const char * suffixURL, const char * readAPIKey)
+        {
+            int connectStatus = connectThingSpeak();
+            if(connectStatus != TS_OK_SUCCESS)
+            {
+                this->lastReadStatus = connectStatus;
+                return String("");
+            }
+
+            // Get data from thingspeak
+            if(!writeReadRequest(channelNumber, suffixURL, readAPIKey)) return abortReadRaw();
+            
+            String content = String();
+            int status = getHTTPResponse(content);
+                
+            this->lastReadStatus = status;
+            
+            emptyStream();
+            
+            #ifdef PRINT_DEBUG_MESSAGES
+                if(status == TS_OK_SUCCESS)
+                {
+                    Serial.print(F("Read: \"")); Serial.print(content); Serial.println(F("\""));
+                }
+            #endif
+                    
+            releaseConnection(status == TS_OK_SUCCESS);
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.println(F("disconnected."));
+            #endif
+
+            if(status != TS_OK_SUCCESS)
+            {
+                return String("");
+            }
+
+            return content;
+        }
+        
+        int requestRaw(unsigned long channelNumber, const char * suffixURL, char * buf, size_t cap, const char * readAPIKey)
+        {
+            int connectStatus = connectThingSpeak();
+            if(connectStatus != TS_OK_SUCCESS)
+            {
+                this->lastReadStatus = connectStatus;
+                return connectStatus;
+            }
+
+            // Get data from thingspeak
+            if(!writeReadRequest(channelNumber, suffixURL, readAPIKey)) return abortRead();
+            
+            size_t length = 0;
+            int status = getHTTPResponse(buf, cap, length);
+            
+            this->lastReadStatus = status;
+            
+            emptyStream();
+            
+            #ifdef PRINT_DEBUG_MESSAGES
+                if(status == TS_OK_SUCCESS)
+                {
+                    Serial.print(F("Read: \"")); Serial.print(buf); Serial.println(F("\""));
+                }
+            #endif
+                    
+            releaseConnection(status == TS_OK_SUCCESS);
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.println(F("disconnected."));
+            #endif
+
+            if(status != TS_OK_SUCCESS)
+            {
+                return (status > 0) ? -status : status;
+            }
+
+            return (int)length;
+        }
+        
+        #ifndef ARDUINO_AVR_UNO
+            int requestFeedRange(unsigned long channelNumber, const char * suffixURL, void (*rowCallback)(const feedRow & row), const char * readAPIKey)
+            {
+                int connectStatus = connectThingSpeak();
+                if(connectStatus != TS_OK_SUCCESS)
+                {
+                    this->lastReadStatus = connectStatus;
+                    return connectStatus;
+                }
+                
+                if(!writeReadRequest(channelNumber, suffixURL, readAPIKey)) return abortRead();
+                
+                int contentLength = 0;
+                int status = readHTTPResponseHeader(contentLength);
+                this->lastReadStatus = status;
+                if(status != TS_OK_SUCCESS)
+                {
+                    emptyStream();
+                    releaseConnection(false);
+                    return (status > 0) ? -status : status;
+                }
+                
+                long rows = parseFeedCSV(contentLength, rowCallback);
+                
+                releaseConnection(rows >= 0);
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("               Rows: ")); Serial.println(rows);
+                #endif
+                
+                if(rows < 0) this->lastReadStatus = (int)rows;
+                return (int)rows;
+            }
+        #endif
+        
+        int postUpdate(unsigned long channelNumber, const String & postMessage, const char * writeAPIKey)
+        {
+            int status = sendUpdate(channelNumber, postMessage, writeAPIKey);
+            #ifndef ARDUINO_AVR_UNO
+                if(staleConnectionFailed(status)) status = sendUpdate(channelNumber, postMessage, writeAPIKey);
+            #endif
+            
+            return status;
+        }
+        
+        int sendUpdate(unsigned long channelNumber, const String & postMessage, const char * writeAPIKey)
+        {
+            (void)channelNumber; // only used by the read cache and the trace, which the Uno build leaves out
+            
+            int connectStatus = connectThingSpeak();
+            if(connectStatus != TS_OK_SUCCESS)
+            {
+                // Failed to connect to ThingSpeak
+                return connectStatus;
+            }
+            
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("               POST \""));Serial.print(postMessage);Serial.println(F("\""));
+            #endif
+
+            // Post data to thingspeak
+            TS_TRACE_EVENT(TS_TRACE_REQUEST, channelNumber, postMessage.length());
+            if(!printFlash(*this->client, F("POST /update HTTP/1.1\r\n"))) return abortWriteRaw();
+            if(!writeHTTPHeader(writeAPIKey)) return abortWriteRaw();
+            if(!printFlash(*this->client, F("Content-Type: application/x-www-form-urlencoded\r\n"))) return abortWriteRaw();
+            if(!printFlash(*this->client, F("Content-Length: "))) return abortWriteRaw();
+            if(!this->client->print(postMessage.length())) return abortWriteRaw();
+            if(!printFlash(*this->client, F("\r\n\r\n"))) return abortWriteRaw();
+            if(!this->client->print(postMessage)) return abortWriteRaw();
+            
+            #ifndef ARDUINO_AVR_UNO
+                invalidateReadCache(channelNumber);
+            #endif
+            
+            return finishWrite();
+        }
+        
+        #ifndef ARDUINO_AVR_UNO
+            bool sampleBatchDue(priorityQueue & queue)
+            {
+                if(queue.header.count >= queue.batchMin) return true;
+                if(0 == queue.batchMaxAge) return false;
+                
+                unsigned long time = currentTime();
+                return 0 != time && time - queue.header.headTime >= queue.batchMaxAge;
+            }
+            
+            int writeSampleQueue(priorityQueue & queue, unsigned long channelNumber, const char * writeAPIKey)
+            {
+                uint16_t samples = queue.header.count < TS_BULK_UPDATE_MAX ? queue.header.count : TS_BULK_UPDATE_MAX;
+                
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("ts::writeQueuedFields (channelNumber: ")); Serial.print(channelNumber); Serial.print(F(" writeAPIKey: ")); Serial.print(writeAPIKey); Serial.print(F(" samples: ")); Serial.print(samples); Serial.println(F(")"));
+                #endif
+                
+                // Format the body twice, first only to size it, so that it never has to be held in memory
+                ThingSpeakByteCounter counter;
+                printQueuedFields(counter, queue, writeAPIKey, samples);
+                
+                int status = postSampleQueue(queue, channelNumber, writeAPIKey, samples, counter.count);
+                if(staleConnectionFailed(status)) status = postSampleQueue(queue, channelNumber, writeAPIKey, samples, counter.count);
+                
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("               Bulk update status: ")); Serial.println(status);
+                #endif
+                
+                // ThingSpeak accepts bulk updates with 202 Accepted
+                if(202 != status && TS_OK_SUCCESS != status)
+                {
+                    return status;
+                }
+                
+                for(uint16_t i = 0; i < samples; i++)
+                {
+                    dropOldestSample(queue);
+                }
+                storeSampleQueue(queue);
+                
+                return TS_OK_SUCCESS;
+            }
+            
+            int postSampleQueue(priorityQueue & queue, unsigned long channelNumber, const char * writeAPIKey, uint16_t samples, size_t length)
+            {
+                int connectStatus = connectThingSpeak();
+                if(connectStatus != TS_OK_SUCCESS)
+                {
+                    return connectStatus;
+                }
+                
+                TS_TRACE_EVENT(TS_TRACE_REQUEST, channelNumber, length);
+                if(!printFlash(*this->client, F("POST /channels/"))) return abortWriteRaw();
+                if(!this->client->print(channelNumber)) return abortWriteRaw();
+                if(!printFlash(*this->client, F("/bulk_update.csv HTTP/1.1\r\n"))) return abortWriteRaw();
+                if(!writeHTTPHeader(NULL)) return abortWriteRaw();
+                if(!printFlash(*this->client, F("Content-Type: application/x-www-form-urlencoded\r\n"))) return abortWriteRaw();
+                if(!printFlash(*this->client, F("Content-Length: "))) return abortWriteRaw();
+                if(!this->client->print(length)) return abortWriteRaw();
+                if(!printFlash(*this->client, F("\r\n\r\n"))) return abortWriteRaw();
+                if(printQueuedFields(*this->client, queue, writeAPIKey, samples) != length) return abortWriteRaw();
+                
+                invalidateReadCache(channelNumber);
+                
+                int contentLength = 0;
+                int status = getHTTPResponseHeader(contentLength);
+                emptyStream();
+                // The body of a bulk update response isn't read, so don't reuse the connection
+                releaseConnection(false);
+                
+                return status;
+            }
+            
+            unsigned long currentTime()
+            {
+                return (NULL != this->timeSource) ? this->timeSource() : now();
+            }
+            
+            void storeSampleQueue(priorityQueue & queue)
+            {
+                memcpy(queue.buffer, &queue.header, sizeof(sampleQueue));
+            }
+            
+            uint8_t sampleQueueByte(priorityQueue & queue, size_t offset)
+            {
+                return queue.buffer[sizeof(sampleQueue) + (queue.header.head + offset) % queue.header.capacity];
+            }
+            
+            // Decode the time delta of the sample at offset, and return the offset of its first value
+            size_t readSampleDelta(priorityQueue & queue, size_t offset, unsigned long & delta)
+            {
+                delta = 0;
+                offset++;   // skip the presence bitmap
+                for(uint8_t shift = 0; ; shift += 7)
+                {
+                    uint8_t byte = sampleQueueByte(queue, offset++);
+                    delta |= (unsigned long)(byte & 0x7F) << shift;
+                    if(!(byte & 0x80)) break;
+                }
+                return offset;
+            }
+            
+            size_t sampleLength(priorityQueue & queue, size_t offset)
+            {
+                unsigned long delta;
+                uint8_t presence = sampleQueueByte(queue, offset);
+                size_t valuesOffset = readSampleDelta(queue, offset, delta);
+                
+                size_t values = 0;
+                for(; presence != 0; presence >>= 1)
+                {
+                    values += presence & 1;
+                }
+                return valuesOffset - offset + 2 * values;
+            }
+            
+            void dropOldestSample(priorityQueue & queue)
+            {
+                size_t length = sampleLength(queue, 0);
+                queue.header.head = (queue.header.head + length) % queue.header.capacity;
+                queue.header.used -= length;
+                queue.header.count--;
+                
+                // The next sample becomes the oldest, its delta turns into the new head time
+                if(queue.header.count > 0)
+                {
+                    unsigned long delta;
+                    readSampleDelta(queue, 0, delta);
+                    queue.header.headTime += delta;
+                }
+            }
+            
+            // Print the body of a bulk update of the oldest samples, and return the number of bytes printed
+            size_t printQueuedFields(Print & out, priorityQueue & queue, const char * writeAPIKey, uint16_t samples)
+            {
+                size_t printed = printFlash(out, F("write_api_key="));
+                printed += out.print(writeAPIKey);
+                printed += printFlash(out, F("&time_format=absolute&updates="));
+                
+                size_t offset = 0;
+                unsigned long timestamp = queue.header.headTime;
+                for(uint16_t iSample = 0; iSample < samples; iSample++)
+                {
+                    unsigned long delta;
+                    uint8_t presence = sampleQueueByte(queue, offset);
+                    offset = readSampleDelta(queue, offset, delta);
+                    if(iSample > 0)
+                    {
+                        timestamp += delta;
+                        printed += printFlash(out, F("%7C"));   // '|' separates samples
+                    }
+                    
+                    char createdAt[TS_ISO8601_LENGTH];
+                    formatISO8601(timestamp, createdAt);
+                    printed += out.print(createdAt);
+                    
+                    // TIMESTAMP,FIELD1,...,FIELD8,LATITUDE,LONGITUDE,ELEVATION,STATUS
+                    for(size_t iField = 0; iField < FIELDNUM_MAX; iField++)
+                    {
+                        printed += out.print(',');
+                        if(!(presence & (1 << iField))) continue;
+                        
+                        uint16_t encoded = sampleQueueByte(queue, offset) | (sampleQueueByte(queue, offset + 1) << 8);
+                        offset += 2;
+                        printed += printSampleValue(out, encoded, queue.header.scale[iField]);
+                    }
+                    printed += printFlash(out, F(",,,,"));
+                }
+                
+                return printed;
+            }
+            
+            size_t printSampleValue(Print & out, uint16_t encoded, float scale)
+            {
+                if(0 == scale)
+                {
+                    return out.print(convertHalfToFloat(encoded), 5);
+                }
+                
+                // Enough decimals to show the resolution of the scale
+                unsigned int decimals = 0;
+                for(float resolution = scale; resolution < 0.99999 && decimals < 5; resolution *= 10)
+                {
+                    decimals++;
+                }
+                return out.print((int16_t)encoded * scale, decimals);
+            }
+            
+            bool encodeSampleValue(float value, float scale, uint16_t & encoded)
+            {
+                if(0 == scale)
+                {
+                    if(!isinf(value) && fabs(value) > TS_FLOAT16_MAX) return false;
+                    encoded = convertFloatToHalf(value);
+                    return true;
+                }
+                
+                float steps = round(value / scale);
+                if(!(steps >= -32767 && steps <= 32767)) return false;
+                encoded = (uint16_t)(int16_t)steps;
+                return true;
+            }
+            
+            uint16_t convertFloatToHalf(float value)
+            {
+                uint32_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                uint16_t sign = (bits >> 16) & 0x8000;
+                int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+                uint32_t mantissa = bits & 0x7FFFFF;
+                
+                if(0xFF == ((bits >> 23) & 0xFF)) return sign | 0x7C00 | (mantissa ? 0x200 : 0);  // Inf and NaN
+                if(exponent >= 31) return sign | 0x7C00;
+                if(exponent <= 0)
+                {
+                    // Subnormal, or too small to represent
+                    if(exponent < -10) return sign;
+                    mantissa |= 0x800000;
+                    unsigned int shift = 14 - exponent;
+                    uint16_t half = mantissa >> shift;
+                    if((mantissa >> (shift - 1)) & 1) half++;
+                    return sign | half;
+                }
+                
+                // Rounding may carry into the exponent, which is still the correctly rounded value
+                uint16_t half = sign | (exponent << 10) | (mantissa >> 13);
+                if(mantissa & 0x1000) half++;
+                return half;
+            }
+            
+            float convertHalfToFloat(uint16_t half)
+            {
+                uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+                uint32_t exponent = (half >> 10) & 0x1F;
+                uint32_t mantissa = half & 0x3FF;
+                
+                if(0 == exponent)
+                {
+                    float value = ldexp((float)mantissa, -24);
+                    return sign ? -value : value;
+                }
+                
+                uint32_t bits = sign | (mantissa << 13) | ((31 == exponent) ? 0x7F800000 : ((exponent + 112) << 23));
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                return value;
+            }
+            
+            bool isNumber(const char * value)
+            {
+                while(isspace(*value)) value++;
+                if('-' == *value || '+' == *value) value++;
+                if(isWordNoCase(value, F("nan")) || isWordNoCase(value, F("inf")) || isWordNoCase(value, F("infinity"))) return true;
+                if(!isdigit(*value) && '.' != *value) return false;
+                
+                char * end;
+                strtod(value, &end);
+                return end != value;
+            }
+            
+            void formatQueryTime(unsigned long epoch, char * text)
+            {
+                // ThingSpeak takes YYYY-MM-DD%20HH:MM:SS in UTC
+                char iso[TS_ISO8601_LENGTH];
+                formatISO8601(epoch, iso);
+                memcpy(text, iso, 10);
+                memcpy(text + 10, "%20", 3);
+                memcpy(text + 13, iso + 11, 8);
+                text[21] = '\0';
+            }
+            
+            int readBodyByte()
+            {
+                if(0 == this->bodyRemaining)
+                {
+                    if(!this->responseChunked) return -1;
+                    
+                    // Chunked transfer: the next chunk size follows the CRLF that ends the previous chunk
+                    char line[12];
+                    size_t length = this->client->readBytesUntil('\n', line, sizeof(line) - 1);
+                    if(length <= 1) length = this->client->readBytesUntil('\n', line, sizeof(line) - 1);
+                    line[length] = '\0';
+                    this->bodyRemaining = strtol(line, NULL, 16);
+                    if(this->bodyRemaining <= 0)
+                    {
+                        this->responseChunked = false;
+                        this->bodyRemaining = 0;
+                        this->client->find(const_cast<char *>("\n"));  // CRLF after the last chunk
+                        return -1;
+                    }
+                }
+                
+                unsigned long timeoutTime = TS_MILLIS() + TIMEOUT_MS_SERVERRESPONSE;
+                while(this->client->available() <= 0)
+                {
+                    // Without Content-Length the body ends when the server closes the connection
+                    if(!this->client->connected()) return (this->bodyRemaining < 0) ? -1 : TS_ERR_TIMEOUT;
+                    if(TS_MILLIS() > timeoutTime) return TS_ERR_TIMEOUT;
+                    TS_DELAY(2);
+                }
+                if(this->bodyRemaining > 0) this->bodyRemaining--;
+                return this->client->read();
+            }
+            
+            long parseFeedCSV(int contentLength, void (*rowCallback)(const feedRow & row))
+            {
+                // Column of each field in the header row (created_at,entry_id,field1,...), TS_CSV_COLUMN_OTHER for columns that are not passed on
+                uint8_t columnKind[TS_CSV_COLUMNS_MAX];
+                uint8_t columns = 0;
+                bool headerRow = true;
+                long rows = 0;
+                
+                feedRow row;
+                char cell[TS_CSV_CELL_MAX];
+                size_t cellLength = 0;
+                uint8_t column = 0;
+                bool quoted = false;
+                bool quoteClosed = false;
+                bool rowStarted = false;
+                
+                this->bodyRemaining = this->responseChunked ? 0 : contentLength;
+                resetFeedRow(row);
+                
+                for(;;)
+                {
+                    int c = readBodyByte();
+                    if(TS_ERR_TIMEOUT == c) return TS_ERR_TIMEOUT;
+                    
+                    if(quoted && c >= 0)
+                    {
+                        if('"' == c)
+                        {
+                            quoted = false;
+                            quoteClosed = true;
+                        }
+                        else if(cellLength < sizeof(cell) - 1)
+                        {
+                            cell[cellLength++] = c;
+                        }
+                        continue;
+                    }
+                    if('"' == c)
+                    {
+                        // A quote right after the closing quote is an escaped quote ("")
+                        if(quoteClosed && cellLength < sizeof(cell) - 1) cell[cellLength++] = '"';
+                        quoted = true;
+                        quoteClosed = false;
+                        rowStarted = true;
+                        continue;
+                    }
+                    quoteClosed = false;
+                    if('\r' == c) continue;
+                    if(c >= 0 && ',' != c && '\n' != c)
+                    {
+                        if(cellLength < sizeof(cell) - 1) cell[cellLength++] = c;
+                        rowStarted = true;
+                        continue;
+                    }
+                    
+                    // End of a cell
+                    cell[cellLength] = '\0';
+                    if(rowStarted || ',' == c)
+                    {
+                        if(headerRow)
+                        {
+                            if(columns < TS_CSV_COLUMNS_MAX) columnKind[columns++] = getCSVColumnKind(cell);
+                        }
+                        else if(column < columns)
+                        {
+                            setFeedRowValue(row, columnKind[column], cell);
+                        }
+                        column++;
+                        rowStarted = true;
+                    }
+                    cellLength = 0;
+                    
+                    // End of a row
+                    if(',' != c && rowStarted)
+                    {
+                        if(!headerRow)
+                        {
+                            rowCallback(row);
+                            rows++;
+                        }
+                        headerRow = false;
+                        resetFeedRow(row);
+                        column = 0;
+                        rowStarted = false;
+                    }
+                    if(c < 0) break;
+                }
+                
+                return rows;
+            }
+            
+            uint8_t getCSVColumnKind(const char * name)
+            {
+                if(0 == strcmp_P(name, PSTR("created_at"))) return TS_CSV_COLUMN_CREATED_AT;
+                if(0 == strcmp_P(name, PSTR("entry_id"))) return TS_CSV_COLUMN_ENTRY_ID;
+                if(startsWithNoCase(name, F("field")))
+                {
+                    int field = atoi(name + 5);
+                    if(field >= FIELDNUM_MIN && field <= FIELDNUM_MAX) return field;
+                }
+                return TS_CSV_COLUMN_OTHER;
+            }
+            
+            void setFeedRowValue(feedRow & row, uint8_t kind, const char * value)
+            {
+                if(TS_CSV_COLUMN_CREATED_AT == kind)
+                {
+                    parseCSVTime(value, row.createdAt);
+                }
+                else if(TS_CSV_COLUMN_ENTRY_ID == kind)
+                {
+                    row.entryID = convertCharToLong(value);
+                }
+                else if(kind >= FIELDNUM_MIN && kind <= FIELDNUM_MAX && isNumber(value))
+                {
+                    row.field[kind - 1] = convertCharToFloat(value);
+                }
+            }
+            
+            void resetFeedRow(feedRow & row)
+            {
+                row.createdAt = 0;
+                row.entryID = 0;
+                for(size_t iField = 0; iField < FIELDNUM_MAX; iField++)
+                {
+                    row.field[iField] = NAN;
+                }
+            }
+            
+            bool parseCSVTime(const char * text, unsigned long & epoch)
+            {
+                // YYYY-MM-DD HH:MM:SS UTC, or with a numeric offset such as -0500 for other time zones
+                char * end;
+                unsigned long year = strtoul(text, &end, 10);
+                if('-' != *end) return false;
+                unsigned long month = strtoul(end + 1, &end, 10);
+                if('-' != *end) return false;
+                unsigned long day = strtoul(end + 1, &end, 10);
+                unsigned long hour = strtoul(end + 1, &end, 10);
+                if(':' != *end) return false;
+                unsigned long minute = strtoul(end + 1, &end, 10);
+                if(':' != *end) return false;
+                unsigned long second = strtoul(end + 1, &end, 10);
+                if(!convertCivilToEpoch(year, month, day, hour, minute, second, epoch)) return false;
+                
+                while(' ' == *end) end++;
+                if('+' == *end || '-' == *end)
+                {
+                    unsigned long offset = strtoul(end + 1, NULL, 10);
+                    unsigned long offsetSeconds = (offset / 100) * 3600UL + (offset % 100) * 60UL;
+                    epoch = ('+' == *end) ? epoch - offsetSeconds : epoch + offsetSeconds;
+                }
+                return true;
+            }
+        #endif
+        
+        #ifdef TS_TRACE
+            void traceEvent(uint8_t id, long a, long b)
+            {
+                traceEntry & event = this->traceEvents[this->traceNext];
+                event.time = micros();
+                event.id = id;
+                event.a = a;
+                event.b = b;
+                if(++this->traceNext == TS_TRACE_EVENTS) this->traceNext = 0;
+                if(this->traceCount < TS_TRACE_EVENTS) this->traceCount++;
+            }
+            
+            const __FlashStringHelper * getTraceEventName(uint8_t id)
+            {
+                switch(id)
+                {
+                    case TS_TRACE_CONNECT: return F("connect");
+                    case TS_TRACE_REUSE: return F("reuse");
+                    case TS_TRACE_REQUEST: return F("request");
+                    case TS_TRACE_RESPONSE: return F("response");
+                    case TS_TRACE_TIMEOUT: return F("timeout");
+                    case TS_TRACE_RETRY: return F("retry");
+                    case TS_TRACE_RELEASE: return F("release");
+                    default: return F("?");
+                }
+            }
+        #endif
+        
+        #ifdef TS_MEMORY_STATS
+            // Measures the public call it's created in; calls made by that call are measured as part of it.
+            // stackTop is the frame address of that call, so the stack depth is measured from the call itself.
+            class memoryScope
+            {
+              public:
+                memoryScope(ThingSpeakClass * owner, unsigned int call, void * stackTop) : owner(owner), active(!owner->memoryScopeActive)
+                {
+                    if(!this->active) return;
+                    owner->memoryScopeActive = true;
+                    owner->memoryCall = call;
+                    owner->memoryStackTop = reinterpret_cast<uintptr_t>(stackTop);
+                    owner->memoryFreeStart = owner->getFreeMemory();
+                    owner->memoryCounters[call].calls++;
+                }
+                
+                ~memoryScope()
+                {
+                    if(!this->active) return;
+                    this->owner->sampleMemory();
+                    this->owner->memoryScopeActive = false;
+                }
+                
+              private:
+                ThingSpeakClass * owner;
+                bool active;
+            };
+            
+            void sampleMemory()
+            {
+                if(!this->memoryScopeActive) return;
+                memoryStats & counters = this->memoryCounters[this->memoryCall];
+                
+                // The stack grows down; a sample from no deeper than the call counts as 0 rather than wrapping
+                char bottom;
+                uintptr_t stackBottom = reinterpret_cast<uintptr_t>(&bottom);
+                size_t depth = (this->memoryStackTop > stackBottom) ? this->memoryStackTop - stackBottom : 0;
+                if(depth > counters.stackPeak) counters.stackPeak = depth;
+                
+                long freeMemory = getFreeMemory();
+                if(freeMemory < 0) return;
+                if(counters.freeMin <= 0 || freeMemory < counters.freeMin) counters.freeMin = freeMemory;
+                if(this->memoryFreeStart - freeMemory > counters.peakUse) counters.peakUse = this->memoryFreeStart - freeMemory;
+            }
+        #endif
+        
+        size_t printFlash(Print & out, const __FlashStringHelper * text)
+        {
+            // Print::print() sends a flash string one byte at a time, which many network clients turn into one packet per byte.  Copy it to RAM in chunks instead.
+            const char * flash = reinterpret_cast<const char *>(text);
+            size_t length = strlen_P(flash);
+            size_t printed = 0;
+            char chunk[32];
+            while(printed < length)
+            {
+                size_t count = (length - printed < sizeof(chunk)) ? length - printed : sizeof(chunk);
+                memcpy_P(chunk, flash + printed, count);
+                size_t written = out.write((const uint8_t *)chunk, count);
+                printed += written;
+                if(written != count) break;
+            }
+            return printed;
+        }
+        
+        void emptyStream(){
+            while(this->client->available() > 0){
+                this->client->read();
+            }
+        }
+        
+        int finishWrite(){
+            String entryIDText = String();
+            int status = getHTTPResponse(entryIDText);
+            
+            emptyStream();
+            
+            if(status != TS_OK_SUCCESS)
+            {
+                releaseConnection(false);
+                return status;
+            }
+            long entryID = entryIDText.toInt();
+
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("               Entry ID \""));Serial.print(entryIDText);Serial.print(F("\" ("));Serial.print(entryID);Serial.println(F(")"));
+            #endif
+            
+            releaseConnection(true);
+            
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.println(F("disconnected."));
+            #endif
+            if(entryID == 0)
+            {
+                // ThingSpeak did not accept the write
+                status = TS_ERR_NOT_INSERTED;
+            }
+            
+            return status;
+        }
+        
+        String getJSONValueByKey(const String & textToSearch, const __FlashStringHelper * key)
+        {
+            const char * text = textToSearch.c_str();
+            size_t position = 0;
+            jsonMember member;
+            while(nextJSONMember(text, position, member))
+            {
+                if(jsonKeyIs(text, member, key))
+                {
+                    // There is no value to return if it's null
+                    if(!member.string) break;
+                    return textToSearch.substring(member.valueStart, member.valueStart + member.valueLength);
+                }
+            }
+            
+            return String("");
+        }
+        
+        bool nextJSONMember(const char * text, size_t & position, jsonMember & member)
+        {
+            // Finds the next "key":value pair in one pass from position, and moves position past it
+            for(;;)
+            {
+                const char * quote = strchr(text + position, '"');
+                if(NULL == quote) return false;
+                
+                size_t keyStart = quote - text + 1;
+                size_t keyEnd = skipJSONString(text, keyStart);
+                if('\0' == text[keyEnd]) return false;
+                
+                size_t i = keyEnd + 1;
+                while(isspace(text[i])) i++;
+                if(':' != text[i])
+                {
+                    // A string in an array, not a key
+                    position = keyEnd + 1;
+                    continue;
+                }
+                i++;
+                while(isspace(text[i])) i++;
+                
+                member.keyStart = keyStart;
+                member.keyLength = keyEnd - keyStart;
+                member.string = ('"' == text[i]);
+                if(member.string)
+                {
+                    member.valueStart = i + 1;
+                    i = skipJSONString(text, i + 1);
+                    if('\0' == text[i]) return false;
+                    position = i + 1;
+                }
+                else
+                {
+                    // null, a number, or the start of a nested object, whose members are found next
+                    member.valueStart = i;
+                    while('\0' != text[i] && ',' != text[i] && '}' != text[i] && ']' != text[i] && '{' != text[i] && '[' != text[i]) i++;
+                    position = i;
+                }
+                member.valueLength = i - member.valueStart;
+                return true;
+            }
+        }
+        
+        size_t skipJSONString(const char * text, size_t position)
+        {
+            // Returns the position of the closing quote, stepping over escaped characters
+            while('\0' != text[position] && '"' != text[position])
+            {
+                if('\\' == text[position] && '\0' != text[position + 1]) position++;
+                position++;
+            }
+            return position;
+        }
+        
+        bool jsonKeyIs(const char * text, const jsonMember & member, const __FlashStringHelper * key)
+        {
+            const char * flashKey = reinterpret_cast<const char *>(key);
+            return strlen_P(flashKey) == member.keyLength && 0 == strncmp_P(text + member.keyStart, flashKey, member.keyLength);
+        }
+        
+        int copyToBuffer(const String & value, char * buf, size_t cap)
+        {
+            if(NULL == buf || 0 == cap)
+            {
+                this->lastReadStatus = TS_ERR_OUT_OF_RANGE;
+                return TS_ERR_OUT_OF_RANGE;
+            }
+            
+            size_t length = value.length();
+            this->lastReadStatus = TS_OK_SUCCESS;
+            if(length > cap - 1)
+            {
+                length = cap - 1;
+                this->lastReadStatus = TS_ERR_OUT_OF_RANGE;
+            }
+            memcpy(buf, value.c_str(), length);
+            buf[length] = '\0';
+            
+            return (this->lastReadStatus == TS_OK_SUCCESS) ? (int)length : TS_ERR_OUT_OF_RANGE;
+        }
+        
+        #ifndef ARDUINO_AVR_UNO
+            int refreshReadCache(unsigned long channelNumber, const char * readAPIKey)
+            {
+                if(this->readCacheValid && this->readCacheChannel == channelNumber && (TS_MILLIS() - this->readCacheTime) < this->readCacheTTL)
+                {
+                    #ifdef PRINT_DEBUG_MESSAGES
+                        Serial.print(F("               Read cache hit for channel ")); Serial.println(channelNumber);
+                    #endif
+                    this->lastReadStatus = TS_OK_SUCCESS;
+                    return TS_OK_SUCCESS;
+                }
+                
+                this->readCacheValid = false;
+                String multiContent = readRaw(channelNumber, String(F("/feeds/last.json?status=true&location=true")), readAPIKey);
+                
+                if(getLastReadStatus() != TS_OK_SUCCESS){
+                    return getLastReadStatus();
+                }
+                
+                parseFeed(multiContent, this->cachedFeed);
+                this->readCacheChannel = channelNumber;
+                this->readCacheTime = TS_MILLIS();
+                this->readCacheValid = true;
+                
+                return TS_OK_SUCCESS;
+            }
+            
+            bool deadbandPasses(deadband & filter, float value)
+            {
+                if(!filter.sent || isnan(value) != isnan(filter.lastSent))
+                {
+                    return true;
+                }
+                if(0 != filter.maxSilence && (TS_MILLIS() - filter.lastSentTime) >= filter.maxSilence)
+                {
+                    return true;
+                }
+                
+                float change = fabs(value - filter.lastSent);
+                if(0 == filter.absoluteThreshold && 0 == filter.percentThreshold)
+                {
+                    return change > 0;
+                }
+                if(0 != filter.absoluteThreshold && change >= filter.absoluteThreshold)
+                {
+                    return true;
+                }
+                // A percentage of 0 is 0, so a value that stays at 0 must not pass
+                if(0 != filter.percentThreshold && change > 0 && change >= fabs(filter.lastSent) * filter.percentThreshold / 100)
+                {
+                    return true;
+                }
+                
+                return false;
+            }
+            
+            void commitDeadbandFields(uint8_t fields)
+            {
+                for(size_t iField = 0; iField < FIELDNUM_MAX; iField++)
+                {
+                    if(fields & (1 << iField))
+                    {
+                        this->deadbands[iField].lastSent = this->deadbands[iField].writing;
+                        this->deadbands[iField].lastSentTime = TS_MILLIS();
+                        this->deadbands[iField].sent = true;
+                    }
+                }
+            }
+            
+            pollState * getPollState(unsigned long channelNumber)
+            {
+                // Reuse the channel's slot, or take over the one polled least recently
+                pollState * state = &this->pollStates[0];
+                for(size_t i = 0; i < TS_POLL_CHANNELS_MAX; i++)
+                {
+                    if(this->pollStates[i].polled && this->pollStates[i].channelNumber == channelNumber) return &this->pollStates[i];
+                    if(!this->pollStates[i].polled || (state->polled && this->pollStates[i].lastPollTime < state->lastPollTime)) state = &this->pollStates[i];
+                }
+                
+                state->channelNumber = channelNumber;
+                state->polled = false;
+                state->lastEntryID = 0;
+                state->lastPollTime = 0;
+                state->lastChangeTime = 0;
+                state->cadence = 0;
+                state->interval = this->pollIntervalMin;
+                
+                return state;
+            }
+            
+            int probeLatestEntry(unsigned long channelNumber, const char * readAPIKey, long lastEntryID, long & entryID)
+            {
+                int status = requestLatestEntry(channelNumber, readAPIKey, lastEntryID, entryID);
+                if(staleConnectionFailed(status)) status = requestLatestEntry(channelNumber, readAPIKey, lastEntryID, entryID);
+                
+                return status;
+            }
+            
+            int requestLatestEntry(unsigned long channelNumber, const char * readAPIKey, long lastEntryID, long & entryID)
+            {
+                int connectStatus = connectThingSpeak();
+                if(connectStatus != TS_OK_SUCCESS)
+                {
+                    return connectStatus;
+                }
+                
+                char suffixURL[44];
+                strcpy_P(suffixURL, PSTR("/feeds/last.json?status=true&location=true"));
+                if(!writeReadRequest(channelNumber, suffixURL, readAPIKey))
+                {
+                    return abortRead();
+                }
+                
+                int contentLength = 0;
+                int status = getHTTPResponseHeader(contentLength);
+                bool bodySkipped = false;
+                
+                if(status == TS_OK_SUCCESS)
+                {
+                    // entry_id directly follows created_at, so the first bytes of the body are enough to tell whether anything changed
+                    char prefix[81];
+                    int prefixLength = min(contentLength, (int)sizeof(prefix) - 1);
+                    for(int i = 0; i < prefixLength; i++){
+                        prefix[i] = client->read();
+                    }
+                    prefix[prefixLength] = '\0';
+                    
+                    const char * entryText = strstr_P(prefix, PSTR("\"entry_id\":"));
+                    entryID = (NULL != entryText) ? convertCharToLong(entryText + 11) : 0;
+                    
+                    if(NULL != entryText && entryID == lastEntryID)
+                    {
+                        status = TS_OK_NOT_MODIFIED;
+                        bodySkipped = true;
+                    }
+                    else
+                    {
+                        String multiContent = String(prefix);
+                        multiContent.reserve(contentLength);
+                        for(int i = prefixLength; i < contentLength; i++){
+                            multiContent.concat((char)client->read());
+                        }
+                        
+                        if(NULL == entryText)
+                        {
+                            entryText = strstr_P(multiContent.c_str(), PSTR("\"entry_id\":"));
+                            entryID = (NULL == entryText) ? 0 : convertCharToLong(entryText + 11);
+                        }
+                        
+                        if(entryID == lastEntryID)
+                        {
+                            // Also covers channels without any entry yet
+                            status = TS_OK_NOT_MODIFIED;
+                        }
+                        else
+                        {
+                            parseFeed(multiContent, this->lastFeed);
+                        }
+                    }
+                }
+                
+                if(bodySkipped)
+                {
+                    // Close instead of downloading the rest of an entry that didn't change; with the body unread the connection can't be reused
+                    releaseConnection(false);
+                }
+                else
+                {
+                    emptyStream();
+                    releaseConnection(status == TS_OK_SUCCESS || status == TS_OK_NOT_MODIFIED);
+                }
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("               Entry ID ")); Serial.print(entryID); if(status == TS_OK_NOT_MODIFIED) Serial.print(F(" (unchanged)")); Serial.println();
+                    Serial.println(F("disconnected."));
+                #endif
+                
+                return status;
+            }
+            
+            void invalidateReadCache(unsigned long channelNumber)
+            {
+                if(this->readCacheChannel == channelNumber)
+                {
+                    this->readCacheValid = false;
+                }
+            }
+            
+            void parseFeed(String & multiContent, feed & record)
+            {
+                // Missing and null values are returned as empty strings
+                for(size_t iField = 0; iField < FIELDNUM_MAX; iField++)
+                {
+                    record.nextReadField[iField] = String("");
+                }
+                record.nextReadCreatedAt = String("");
+                record.nextReadLatitude = String("");
+                record.nextReadLongitude = String("");
+                record.nextReadElevation = String("");
+                record.nextReadStatus = String("");
+                
+                // Take every value in a single pass over the response instead of searching it once per key
+                const char * text = multiContent.c_str();
+                size_t position = 0;
+                jsonMember member;
+                while(nextJSONMember(text, position, member))
+                {
+                    if(!member.string) continue;
+                    
+                    String * value = NULL;
+                    const char * key = text + member.keyStart;
+                    if(6 == member.keyLength && 0 == strncmp_P(key, PSTR("field"), 5) && key[5] >= '1' && key[5] <= '8')
+                    {
+                        value = &record.nextReadField[key[5] - '1'];
+                    }
+                    else if(jsonKeyIs(text, member, F("created_at"))) value = &record.nextReadCreatedAt;
+                    else if(jsonKeyIs(text, member, F("latitude"))) value = &record.nextReadLatitude;
+                    else if(jsonKeyIs(text, member, F("longitude"))) value = &record.nextReadLongitude;
+                    else if(jsonKeyIs(text, member, F("elevation"))) value = &record.nextReadElevation;
+                    else if(jsonKeyIs(text, member, F("status"))) value = &record.nextReadStatus;
+                    
+                    if(NULL != value)
+                    {
+                        *value = multiContent.substring(member.valueStart, member.valueStart + member.valueLength);
+                    }
+                }
+                #ifdef TS_MEMORY_STATS
+                    sampleMemory();
+                #endif
+            }
+        #endif
+        
+        int abortWriteRaw()
+        {
+            while(this->client->available() > 0){
+                this->client->read();
+            }
+            releaseConnection(false);
+            
+            return TS_ERR_UNEXPECTED_FAIL;
+        }
+
+        String abortReadRaw()
+        {
+            abortRead();
+            return String("");
+        }
+        
+        int abortRead()
+        {
+            while(this->client->available() > 0){
+                this->client->read();
+            }
+            releaseConnection(false);
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.println(F("ReadRaw abort - disconnected."));
+            #endif
+            this->lastReadStatus = TS_ERR_UNEXPECTED_FAIL;
+            return TS_ERR_UNEXPECTED_FAIL;
+        }
+
+        void setPort(unsigned int port)
+        {
+            this->port = port;
+        }
+        
+        void setClient(Client * client)
+        {
+            this->client = client;
+            
+        }
+        
+        Client * client = NULL;
+        const char * server = THINGSPEAK_URL;
+        unsigned int port = THINGSPEAK_PORT_NUMBER;
+        bool secureConnection = false;
+        #ifndef ARDUINO_AVR_UNO
+            int (*hostResolver)(const char * host, IPAddress & address) = NULL;
+            IPAddress serverAddress;
+            unsigned long serverResolveTTL = TS_DNS_CACHE_TTL_MS;
+            unsigned long serverResolveTime = 0;
+            unsigned int serverConnectFailures = 0;
+            bool serverResolved = false;
+        #endif
+        #ifndef ARDUINO_AVR_UNO
+            bool connectionPrepared = false;
+        #endif
+        #ifndef ARDUINO_AVR_UNO
+            bool connectionKept = false;
+            unsigned long connectionIdleSince = 0;
+            unsigned long keepAliveIdle = 0;
+            bool responseCloses = false;
+            bool connectionReused = false;
+        #endif
+        bool responseChunked = false;
+        #ifndef ARDUINO_AVR_UNO
+            requestTemplate writeTemplateState = {};
+        #endif
+        #ifdef TS_TRACE
+            traceEntry traceEvents[TS_TRACE_EVENTS];
+            size_t traceNext = 0;
+            size_t traceCount = 0;
+        #endif
+        #ifdef TS_MEMORY_STATS
+            memoryStats memoryCounters[TS_MEMORY_CALLS] = {};
+            bool memoryScopeActive = false;
+            unsigned int memoryCall = 0;
+            uintptr_t memoryStackTop = 0;
+            long memoryFreeStart = 0;
+        #endif
+        long bodyRemaining = 0;
+        unsigned long lastConnectMs = 0;
+        #ifndef ARDUINO_AVR_UNO
+            unsigned long preparedTime = 0;
+            unsigned long preparedConnectMs = 0;
+            unsigned long prepareLeadTime = TS_PREPARE_LEAD_MS;
+            connectionStats stats = {};
+        #endif
+        #ifndef ARDUINO_AVR_UNO
+            ThingSpeakSessionCache * sessionCache = NULL;
+        #endif
+        #ifndef ARDUINO_AVR_UNO
+            int circuitState = TS_CIRCUIT_CLOSED;
+            unsigned int circuitThreshold = 0;
+            unsigned int circuitFailures = 0;
+            unsigned int circuitTrips = 0;
+            unsigned long circuitBackoffBase = 0;
+            unsigned long circuitBackoffMax = 0;
+            unsigned long circuitBackoff = 0;
+            unsigned long circuitOpenTime = 0;
+        #endif
+        String nextWriteField[8];
+        float nextWriteLatitude;
+        float nextWriteLongitude;
+        float nextWriteElevation;
+        int lastReadStatus;
+        String nextWriteStatus;
+        String nextWriteCreatedAt;
+        #ifndef ARDUINO_AVR_UNO
+            String pendingWrite;
+            unsigned long pendingWriteChannel = 0;
+            const char * pendingWriteAPIKey = NULL;
+            unsigned int retryMaxAttempts = 1;
+            unsigned long retryBackoff = 1000;
+            unsigned long retryBudget = 10000;
+        #endif
+        unsigned long (*timeSource)() = NULL;
+        bool clockSynced = false;
+        unsigned long clockEpoch = 0;
+        unsigned long clockMillis = 0;
+        float clockDriftPpm = 0;
+        long clockCorrectionMs = 0;
+        unsigned long clockCorrectionSpanMs = 0;
+        #ifndef ARDUINO_AVR_UNO
+            feed lastFeed;
+            feed cachedFeed;
+            unsigned long readCacheTTL = 0;
+            unsigned long readCacheChannel = 0;
+            unsigned long readCacheTime = 0;
+            bool readCacheValid = false;
+            pollState pollStates[TS_POLL_CHANNELS_MAX] = {};
+            rateLimit rateLimits[TS_RATE_LIMIT_CHANNELS_MAX] = {};
+            unsigned long rateLimitInterval = 0;
+            unsigned long pollIntervalMin = TS_POLL_INTERVAL_MS_MIN;
+            unsigned long pollIntervalMax = TS_POLL_INTERVAL_MS_MAX;
+            void (*feedChangedCallback)(unsigned long channelNumber) = NULL;
+            deadband deadbands[FIELDNUM_MAX] = {};
+            deadbandStats deadbandCounters = {};
+            uint8_t deadbandPendingFields = 0;
+            uint8_t pendingWriteDeadbandFields = 0;
+            bool deadbandSuppressedSinceWrite = false;
+            aggregate aggregates[TS_AGGREGATE_SERIES_MAX] = {};
+            uint8_t aggregateSeries[FIELDNUM_MAX] = {};
+            uint8_t aggregateStatistic[FIELDNUM_MAX] = {};
+            priorityQueue queues[TS_PRIORITY_LEVELS] = {};
+        #endif
+
+        int connectThingSpeak()
+        {
+            #ifndef ARDUINO_AVR_UNO
+                this->connectionReused = false;
+                
+                if(this->connectionKept)
+                {
+                    this->connectionKept = false;
+                    
+                    // Leftover bytes would be taken for the next response
+                    if(this->client->connected() && 0 == this->client->available() && (TS_MILLIS() - this->connectionIdleSince) < this->keepAliveIdle)
+                    {
+                        #ifdef PRINT_DEBUG_MESSAGES
+                            Serial.println(F("               Reuse kept-alive connection"));
+                        #endif
+                        TS_STATS_ADD(keepAliveReused, 1);
+                        TS_TRACE_EVENT(TS_TRACE_REUSE, 1, 0);
+                        this->connectionReused = true;
+                        return TS_OK_SUCCESS;
+                    }
+                    
+                    this->client->stop();
+                }
+                
+                if(this->connectionPrepared)
+                {
+                    this->connectionPrepared = false;
+                    
+                    if(this->client->connected() && (TS_MILLIS() - this->preparedTime) < TS_PREPARED_MAX_IDLE_MS)
+                    {
+                        #ifdef PRINT_DEBUG_MESSAGES
+                            Serial.println(F("               Use prepared connection"));
+                        #endif
+                        TS_STATS_ADD(preparedUsed, 1);
+                        TS_STATS_ADD(latencySavedMs, this->preparedConnectMs);
+                        TS_TRACE_EVENT(TS_TRACE_REUSE, 2, 0);
+                        this->connectionReused = true;
+                        return TS_OK_SUCCESS;
+                    }
+                    
+                    // The server may have closed the idle connection, start over
+                    this->client->stop();
+                    TS_STATS_ADD(preparedStale, 1);
+                }
+            #endif
+            
+            return openConnection();
+        }
+        
+        void releaseConnection(bool reusable)
+        {
+            #ifndef ARDUINO_AVR_UNO
+                if(reusable && 0 != this->keepAliveIdle && !this->responseCloses && this->client->connected())
+                {
+                    TS_TRACE_EVENT(TS_TRACE_RELEASE, 1, 0);
+                    this->connectionKept = true;
+                    this->connectionIdleSince = TS_MILLIS();
+                    return;
+                }
+                this->connectionKept = false;
+            #else
+                (void)reusable; // connections are not kept open on Uno
+            #endif
+            
+            TS_TRACE_EVENT(TS_TRACE_RELEASE, 0, 0);
+            this->client->stop();
+        }
+        
+        #ifndef ARDUINO_AVR_UNO
+            // The server may close a kept or prepared connection while it is idle, which only shows once a request is sent on it.
+            // Such a request never reached the server, so it is sent once more on a new connection before it counts as failed.
+            bool staleConnectionFailed(int status)
+            {
+                if(!this->connectionReused || TS_ERR_UNEXPECTED_FAIL != status) return false;
+                
+                this->connectionReused = false;
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.println(F("               Reused connection was closed, send again"));
+                #endif
+                TS_STATS_ADD(staleResent, 1);
+                return true;
+            }
+        #endif
+        
+        #ifndef ARDUINO_AVR_UNO
+            void recordChannelWrite(unsigned long channelNumber)
+            {
+                // Reuse the channel's slot, or take over the one written least recently
+                rateLimit * limit = &this->rateLimits[0];
+                for(size_t i = 0; i < TS_RATE_LIMIT_CHANNELS_MAX; i++)
+                {
+                    if(this->rateLimits[i].written && this->rateLimits[i].channelNumber == channelNumber)
+                    {
+                        limit = &this->rateLimits[i];
+                        break;
+                    }
+                    if(!this->rateLimits[i].written || (limit->written && this->rateLimits[i].lastWriteTime < limit->lastWriteTime)) limit = &this->rateLimits[i];
+                }
+                
+                limit->channelNumber = channelNumber;
+                limit->written = true;
+                limit->lastWriteTime = TS_MILLIS();
+            }
+        #endif
+        
+        int openConnection()
+        {
+            #ifndef ARDUINO_AVR_UNO
+                if(!circuitAllowsConnect())
+                {
+                    #ifdef PRINT_DEBUG_MESSAGES
+                        Serial.println(F("               Circuit open, connect skipped"));
+                    #endif
+                    TS_STATS_ADD(circuitRejected, 1);
+                    return TS_ERR_CIRCUIT_OPEN;
+                }
+            #endif
+            
+            bool connectSuccess = false;
+            bool resumeSession = false;
+            
+            #ifndef ARDUINO_AVR_UNO
+                if(this->secureConnection && NULL != this->sessionCache)
+                {
+                    resumeSession = this->sessionCache->beforeConnect();
+                }
+            #endif
+            
+            unsigned long connectStart = TS_MILLIS();
+            
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("               Connect to ThingSpeak: "));
+                Serial.print(this->server);
+                Serial.print(F(":"));
+                Serial.print(this->port);
+                Serial.print(F("..."));
+            #endif
+            
+            connectSuccess = connectServer();
+                
+            this->lastConnectMs = TS_MILLIS() - connectStart;
+            TS_STATS_ADD(connectTimeMs, this->lastConnectMs);
+            TS_TRACE_EVENT(TS_TRACE_CONNECT, this->lastConnectMs, connectSuccess);
+            if(connectSuccess)
+            {
+                TS_STATS_ADD(connects, 1);
+                if(resumeSession)
+                {
+                    TS_STATS_ADD(resumedHandshakes, 1);
+                    TS_STATS_ADD(resumedHandshakeTimeMs, this->lastConnectMs);
+                }
+                else if(this->secureConnection)
+                {
+                    TS_STATS_ADD(fullHandshakes, 1);
+                    TS_STATS_ADD(fullHandshakeTimeMs, this->lastConnectMs);
+                }
+            }
+            else
+            {
+                TS_STATS_ADD(connectFailures, 1);
             }
+                
+            #ifndef ARDUINO_AVR_UNO
+                if(this->secureConnection && NULL != this->sessionCache)
+                {
+                    this->sessionCache->afterConnect(connectSuccess);
+                }
+            #endif
             
-            textToSearch.remove(toPosition);
+            #ifndef ARDUINO_AVR_UNO
+                recordCircuitResult(connectSuccess);
+            #endif
+                
+            #ifdef PRINT_DEBUG_MESSAGES
+                if (connectSuccess)
+                {
+                    Serial.print(F("Success (")); Serial.print(this->lastConnectMs); if(resumeSession) Serial.print(F(" ms, resumed session).")); else Serial.print(F(" ms)."));
+                }
+                else
+                {
+                    Serial.println(F("Failed."));
+                }
+            #endif
             
-            return textToSearch.substring(fromPosition);
+            return connectSuccess ? TS_OK_SUCCESS : TS_ERR_CONNECT_FAILED;
         }
         
         #ifndef ARDUINO_AVR_UNO
-            String parseValues(String & multiContent, String key)
+            bool circuitAllowsConnect()
             {
-                if(multiContent.length() == 0){
-                    return String("");
+                if(TS_CIRCUIT_OPEN != this->circuitState)
+                {
+                    return true;
                 }
                 
-                String searchPhrase = String("\"");
-                searchPhrase.concat(key);
-                searchPhrase.concat("\":\"");
-                
-                int fromPosition = multiContent.indexOf(searchPhrase,0);
-                
-                if(fromPosition == -1){
-                    // return because there is no status or it's null
-                    return String("");
+                if((TS_MILLIS() - this->circuitOpenTime) < this->circuitBackoff)
+                {
+                    return false;
                 }
                 
-                fromPosition = fromPosition + searchPhrase.length();
-                        
-                int toPosition = multiContent.indexOf("\"", fromPosition);
+                // Let one connect through to probe the uplink
+                this->circuitState = TS_CIRCUIT_HALF_OPEN;
+                return true;
+            }
+            
+            void recordCircuitResult(bool connectSuccess)
+            {
+                if(connectSuccess)
+                {
+                    this->circuitFailures = 0;
+                    this->circuitTrips = 0;
+                    this->circuitState = TS_CIRCUIT_CLOSED;
+                    return;
+                }
                 
+                this->circuitFailures++;
+                if(0 == this->circuitThreshold || (TS_CIRCUIT_HALF_OPEN != this->circuitState && this->circuitFailures < this->circuitThreshold))
+                {
+                    return;
+                }
                 
-                if(toPosition == -1){
-                    // return because there is no end quote
-                    return String("");
+                // Exponential backoff, plus up to 25% jitter so that a fleet does not probe in lockstep
+                unsigned long backoff = this->circuitBackoffMax;
+                if(this->circuitTrips < 16 && (this->circuitBackoffBase << this->circuitTrips) < this->circuitBackoffMax)
+                {
+                    backoff = this->circuitBackoffBase << this->circuitTrips;
                 }
+                this->circuitBackoff = backoff + random(backoff / 4 + 1);
+                this->circuitTrips++;
+                this->circuitOpenTime = TS_MILLIS();
+                this->circuitState = TS_CIRCUIT_OPEN;
+                TS_STATS_ADD(circuitOpened, 1);
                 
-                return multiContent.substring(fromPosition, toPosition);
+                #ifdef PRINT_DEBUG_MESSAGES
+                    Serial.print(F("               Circuit open for ")); Serial.print(this->circuitBackoff); Serial.println(F(" ms"));
+                #endif
             }
         #endif
-        
-        int abortWriteRaw()
-        {
-            while(this->client->available() > 0){
-                this->client->read();
-            }
-            this->client->stop();
-            resetWriteFields();
-            
-            return TS_ERR_UNEXPECTED_FAIL;
-        }
 
-        String abortReadRaw()
+        bool connectServer()
         {
-            while(this->client->available() > 0){
-                this->client->read();
-            }
-            this->client->stop();
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.println("ReadRaw abort - disconnected.");
+            #ifndef ARDUINO_AVR_UNO
+                if(resolveServer())
+                {
+                    bool connectSuccess = client->connect(this->serverAddress, this->port);
+                    
+                    if(connectSuccess)
+                    {
+                        this->serverConnectFailures = 0;
+                    }
+                    else if(++this->serverConnectFailures >= TS_DNS_CACHE_MAX_CONNECT_FAILURES)
+                    {
+                        // The cached address may be stale
+                        this->serverResolved = false;
+                    }
+                    
+                    return connectSuccess;
+                }
             #endif
-            this->lastReadStatus = TS_ERR_UNEXPECTED_FAIL;
-            return String("");
-        }
-
-        void setPort(unsigned int port)
-        {
-            this->port = port;
-        }
-        
-        void setClient(Client * client)
-        {
-            this->client = client;
             
+            return client->connect(const_cast<char *>(this->server), this->port);
         }
-        
-        Client * client = NULL;
-        unsigned int port = THINGSPEAK_PORT_NUMBER;
-        String nextWriteField[8];
-        float nextWriteLatitude;
-        float nextWriteLongitude;
-        float nextWriteElevation;
-        int lastReadStatus;
-        String nextWriteStatus;
-        String nextWriteCreatedAt;
-        #ifndef ARDUINO_AVR_UNO
-            feed lastFeed;
-        #endif
 
-        bool connectThingSpeak()
-        {
-            bool connectSuccess = false;
-            
-            #ifdef PRINT_DEBUG_MESSAGES
-                Serial.print("               Connect to default ThingSpeak: ");
-                Serial.print(THINGSPEAK_URL);
-                Serial.print(":");
-                Serial.print(this->port);
-                Serial.print("...");
-            #endif
-                    
-            connectSuccess = client->connect(const_cast<char *>(THINGSPEAK_URL), this->port);
-                
-            #ifdef PRINT_DEBUG_MESSAGES
-                if (connectSuccess)
+        #ifndef ARDUINO_AVR_UNO
+            bool resolveServer()
+            {
+                if(NULL == this->hostResolver || this->secureConnection)
                 {
-                    Serial.println("Success.");
+                    return false;
                 }
-                else
+            
+                if(this->serverResolved && (TS_MILLIS() - this->serverResolveTime) < this->serverResolveTTL)
                 {
-                    Serial.println("Failed.");
+                    return true;
                 }
+            
+                this->serverResolved = (1 == this->hostResolver(this->server, this->serverAddress));
+                this->serverResolveTime = TS_MILLIS();
+                this->serverConnectFailures = 0;
+            
+                #ifdef PRINT_DEBUG_MESSAGES
+                    if(this->serverResolved)
+                    {
+                        Serial.print(F("(resolved "));
+                        Serial.print(this->serverAddress[0]); Serial.print(F(".")); Serial.print(this->serverAddress[1]); Serial.print(F("."));
+                        Serial.print(this->serverAddress[2]); Serial.print(F(".")); Serial.print(this->serverAddress[3]);
+                        Serial.print(F(") "));
+                    }
+                #endif
+            
+                return this->serverResolved;
+            }
+        #endif
+
+        bool writeReadRequest(unsigned long channelNumber, const char * suffixURL, const char * readAPIKey)
+        {
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("               GET \"/channels/"));Serial.print(channelNumber);Serial.print(suffixURL);Serial.println(F("\""));
             #endif
             
-            return connectSuccess;
+            TS_TRACE_EVENT(TS_TRACE_REQUEST, channelNumber, 0);
+            if (!printFlash(*this->client, F("GET /channels/"))) return false;
+            if (!this->client->print(channelNumber)) return false;
+            if (!this->client->print(suffixURL)) return false;
+            if (!printFlash(*this->client, F(" HTTP/1.1\r\n"))) return false;
+            if (!writeHTTPHeader(readAPIKey)) return false;
+            if (!printFlash(*this->client, F("\r\n"))) return false;
+            
+            return true;
         }
 
         bool writeHTTPHeader(const char * APIKey)
+        {
+            return writeHTTPHeader(*this->client, APIKey);
+        }
+        
+        bool writeHTTPHeader(Print & out, const char * APIKey)
         {
      
-            if (!this->client->print("Host: api.thingspeak.com\r\n")) return false;
-            if (!this->client->print("User-Agent: ")) return false;
-            if (!this->client->print(TS_USER_AGENT)) return false;
-            if (!this->client->print("\r\n")) return false;
+            if (!printFlash(out, F("Host: "))) return false;
+            if (!out.print(this->server)) return false;
+            // The port is part of the Host header unless it's the standard one, even when THINGSPEAK_PORT_NUMBER was overridden
+            if(this->port != 80 && this->port != 443)
+            {
+                if (!printFlash(out, F(":"))) return false;
+                if (!out.print(this->port)) return false;
+            }
+            if (!printFlash(out, F("\r\n"))) return false;
+            if (!printFlash(out, F("User-Agent: "))) return false;
+            if (!printFlash(out, F(TS_USER_AGENT))) return false;
+            if (!printFlash(out, F("\r\n"))) return false;
             if(NULL != APIKey)
             {
-                if (!this->client->print("X-THINGSPEAKAPIKEY: ")) return false;
-                if (!this->client->print(APIKey)) return false;
-                if (!this->client->print("\r\n")) return false;
+                if (!printFlash(out, F("X-THINGSPEAKAPIKEY: "))) return false;
+                if (!out.print(APIKey)) return false;
+                if (!printFlash(out, F("\r\n"))) return false;
             }
             
             return true;
@@ -1537,82 +5170,281 @@
 
         int getHTTPResponse(String & response)
         {
-            // make sure all of the HTTP request is pushed out of the buffer before looking for a response
-            this->client->flush();
+            int contentLength = 0;
+            int status = getHTTPResponseHeader(contentLength);
+            if(status != TS_OK_SUCCESS)
+            {
+                return status;
+            }
             
-            unsigned long timeoutTime = millis() + TIMEOUT_MS_SERVERRESPONSE;
+            // Size the string once instead of growing it byte by byte
+            response = String("");
+            response.reserve(contentLength);
+            for(int i = 0; i < contentLength; i++){
+                response.concat((char)client->read());
+            }
+            #ifdef TS_MEMORY_STATS
+                sampleMemory();
+            #endif
             
-            while(this->client-> available() < 17){
-                delay(2);
-                if(millis() > timeoutTime){
-                    return TS_ERR_TIMEOUT;
-                }
+            #ifdef PRINT_HTTP
+                Serial.print(F("Response: \""));Serial.print(response);Serial.println(F("\""));
+            #endif
+            
+            return status;
+        }
+        
+        int getHTTPResponse(char * buf, size_t cap, size_t & length)
+        {
+            length = 0;
+            int contentLength = 0;
+            int status = getHTTPResponseHeader(contentLength);
+            if(status != TS_OK_SUCCESS)
+            {
+                return status;
             }
             
-            if(!this->client->find(const_cast<char *>("HTTP/1.1")))
+            // Copy what fits, leaving room for the terminator; anything else is drained by emptyStream()
+            size_t toCopy = (size_t)contentLength;
+            if(toCopy > cap - 1)
             {
-                #ifdef PRINT_HTTP
-                    Serial.println("ERROR: Didn't find HTTP/1.1");
-                #endif
-                return TS_ERR_BAD_RESPONSE; // Couldn't parse response (didn't find HTTP/1.1)
+                toCopy = cap - 1;
+                status = TS_ERR_OUT_OF_RANGE;
             }
+            for(length = 0; length < toCopy; length++){
+                buf[length] = client->read();
+            }
+            buf[length] = '\0';
+            #ifdef TS_MEMORY_STATS
+                sampleMemory();
+            #endif
             
-            int status = this->client->parseInt();
             #ifdef PRINT_HTTP
-                Serial.print("Got Status of ");Serial.println(status);
+                Serial.print(F("Response: \""));Serial.print(buf);Serial.println(F("\""));
             #endif
+            
+            return status;
+        }
+
+        int getHTTPResponseHeader(int & contentLength)
+        {
+            int status = readHTTPResponseHeader(contentLength);
             if(status != TS_OK_SUCCESS)
             {
                 return status;
             }
-
-            // Find Content-Length
-            if(!this->client->find(const_cast<char *>("Content-Length:"))){
+            
+            if(contentLength < 0){
                 #ifdef PRINT_HTTP
-                    Serial.println("ERROR: Didn't find Content-Length header");
+                    Serial.println(F("ERROR: Didn't find Content-Length header"));
                 #endif
-                return TS_ERR_BAD_RESPONSE; // Couldn't parse response (didn't find HTTP/1.1)
+                return TS_ERR_BAD_RESPONSE; // Couldn't parse response (didn't find Content-Length)
             }
-            int contentLength = this->client->parseInt();
             
             #ifdef PRINT_HTTP
-                Serial.print("Content Length: ");
+                Serial.print(F("Content Length: "));
                 Serial.println(contentLength);
+                Serial.println(F("Found end of header"));
             #endif
             
-            if(!this->client->find(const_cast<char *>("\r\n\r\n")))
+            unsigned long timeoutTime = TS_MILLIS() + TIMEOUT_MS_SERVERRESPONSE;
+            
+            while(this->client->available() < contentLength){
+                TS_DELAY(2);
+                if(TS_MILLIS() > timeoutTime){
+                    TS_TRACE_EVENT(TS_TRACE_TIMEOUT, this->client->available(), contentLength);
+                    return TS_ERR_TIMEOUT;
+                }
+            }
+            
+            return status;
+        }
+        
+        int readHTTPResponseHeader(int & contentLength)
+        {
+            // make sure all of the HTTP request is pushed out of the buffer before looking for a response
+            this->client->flush();
+            
+            unsigned long timeoutTime = TS_MILLIS() + TIMEOUT_MS_SERVERRESPONSE;
+            
+            // Wait for "HTTP/1.1 200"; the reason phrase after the status code is optional
+            while(this->client-> available() < 12){
+                // Don't wait out the timeout on a connection that was closed before any response
+                if(0 == this->client->available() && !this->client->connected()) return TS_ERR_UNEXPECTED_FAIL;
+                TS_DELAY(2);
+                if(TS_MILLIS() > timeoutTime){
+                    TS_TRACE_EVENT(TS_TRACE_TIMEOUT, this->client->available(), 12);
+                    return TS_ERR_TIMEOUT;
+                }
+            }
+            
+            if(!this->client->find(const_cast<char *>("HTTP/1.1")))
             {
                 #ifdef PRINT_HTTP
-                    Serial.println("ERROR: Didn't find end of headers");
+                    Serial.println(F("ERROR: Didn't find HTTP/1.1"));
                 #endif
-                return TS_ERR_BAD_RESPONSE;
+                return TS_ERR_BAD_RESPONSE; // Couldn't parse response (didn't find HTTP/1.1)
             }
+            
+            int status = this->client->parseInt();
             #ifdef PRINT_HTTP
-                Serial.println("Found end of header");
+                Serial.print(F("Got Status of "));Serial.println(status);
             #endif
             
-            timeoutTime = millis() + TIMEOUT_MS_SERVERRESPONSE;
+            // Skip the reason phrase, if any, so that the end of the status line isn't taken for the end of the header
+            this->client->find(const_cast<char *>("\n"));
             
-            while(this->client->available() < contentLength){
-                delay(2);
-                if(millis() > timeoutTime){
-                    return TS_ERR_TIMEOUT;
+            // Go through the header lines up to the blank line that ends them, taking Content-Length and the server time from Date
+            contentLength = -1;
+            #ifndef ARDUINO_AVR_UNO
+                this->responseCloses = false;
+            #endif
+            this->responseChunked = false;
+            char line[TS_HEADER_LINE_MAX];
+            for(;;)
+            {
+                size_t length = this->client->readBytesUntil('\n', line, sizeof(line) - 1);
+                if(length == sizeof(line) - 1)
+                {
+                    // Skip the rest of a long line
+                    this->client->find(const_cast<char *>("\n"));
+                }
+                if(length > 0 && '\r' == line[length - 1]) length--;
+                if(0 == length) break;
+                line[length] = '\0';
+                
+                if(startsWithNoCase(line, F("content-length:")))
+                {
+                    contentLength = atoi(line + 15);
+                }
+                #ifndef ARDUINO_AVR_UNO
+                    else if(startsWithNoCase(line, F("connection:")))
+                    {
+                        this->responseCloses = (NULL != strstr_P(line, PSTR("close")));
+                    }
+                #endif
+                else if(startsWithNoCase(line, F("transfer-encoding:")))
+                {
+                    this->responseChunked = (NULL != strstr_P(line, PSTR("chunked")));
+                }
+                else if(startsWithNoCase(line, F("date:")))
+                {
+                    unsigned long serverTime;
+                    if(parseHTTPDate(line + 5, serverTime)) syncClock(serverTime);
                 }
             }
+            TS_TRACE_EVENT(TS_TRACE_RESPONSE, status, contentLength);
+            #ifdef TS_MEMORY_STATS
+                sampleMemory();
+            #endif
             
-            String tempString = String("");
-            char y = 0;
-            for(int i = 0; i < contentLength; i++){
-                y = client->read();
-                tempString.concat(y);
+            return status;
+        }
+        
+        bool parseHTTPDate(const char * text, unsigned long & epoch)
+        {
+            // IMF-fixdate, for example " Mon, 19 Oct 2026 10:00:00 GMT"
+            const char * comma = strchr(text, ',');
+            if(NULL == comma) return false;
+            
+            char * end;
+            unsigned long day = strtoul(comma + 1, &end, 10);
+            while(' ' == *end) end++;
+            static const char months[] PROGMEM = "janfebmaraprmayjunjulaugsepoctnovdec";
+            unsigned int month = 0;
+            for(; month < 12; month++)
+            {
+                if(tolower(end[0]) == pgm_read_byte(months + 3 * month) && tolower(end[1]) == pgm_read_byte(months + 3 * month + 1) && tolower(end[2]) == pgm_read_byte(months + 3 * month + 2)) break;
             }
-            response = tempString;
+            if(month >= 12) return false;
+            unsigned long year = strtoul(end + 3, &end, 10);
+            unsigned long hour = strtoul(end, &end, 10);
+            if(':' != *end) return false;
+            unsigned long minute = strtoul(end + 1, &end, 10);
+            if(':' != *end) return false;
+            unsigned long second = strtoul(end + 1, &end, 10);
+            return convertCivilToEpoch(year, month + 1, day, hour, minute, second, epoch);
+        }
+        
+        bool convertCivilToEpoch(unsigned long year, unsigned long month, unsigned long day, unsigned long hour, unsigned long minute, unsigned long second, unsigned long & epoch)
+        {
+            if(year < 1970 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
             
-            #ifdef PRINT_HTTP
-                Serial.print("Response: \"");Serial.print(response);Serial.println("\"");
-            #endif
+            // Days since 1970-01-01 of a civil date, see http://howardhinnant.github.io/date_algorithms.html
+            if(month <= 2) year--;
+            unsigned long era = year / 400;
+            unsigned long yearOfEra = year - era * 400;
+            unsigned long dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+            unsigned long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+            unsigned long days = era * 146097UL + dayOfEra - 719468UL;
             
-            return status;
+            epoch = days * 86400UL + hour * 3600UL + minute * 60UL + second;
+            return true;
+        }
+        
+        unsigned long clockElapsedMs()
+        {
+            // Unsigned, like the other millis() intervals, so that it doesn't overflow after 24.8 days
+            unsigned long elapsed = TS_MILLIS() - this->clockMillis;
+            return elapsed + (long)(elapsed * this->clockDriftPpm / 1000000.0);
+        }
+        
+        void syncClock(unsigned long serverTime)
+        {
+            unsigned long receivedMillis = TS_MILLIS();
+            
+            if(this->clockSynced)
+            {
+                // The server time is exact to the second, so the time when the response arrived is within [serverTime, serverTime + 1s).
+                // Slew the clock into that window, and step it only when it's far off.
+                // Compare whole seconds first, so that the offset in ms can't overflow however long ago the clock was set
+                unsigned long elapsed = clockElapsedMs();
+                long offsetSeconds = (long)(this->clockEpoch + elapsed / 1000 - serverTime);
+                long offset = 0;
+                long correction = TS_CLOCK_STEP_MS;
+                if(labs(offsetSeconds) <= TS_CLOCK_STEP_MS / 1000)
+                {
+                    offset = offsetSeconds * 1000L + (long)(elapsed % 1000);
+                    correction = 0;
+                    if(offset < 0) correction = -offset;
+                    else if(offset > 999) correction = 999 - offset;
+                }
+                
+                if(labs(correction) < TS_CLOCK_STEP_MS)
+                {
+                    this->clockCorrectionMs += correction;
+                    this->clockCorrectionSpanMs += receivedMillis - this->clockMillis;
+                    if(this->clockCorrectionSpanMs >= TS_CLOCK_DRIFT_WINDOW_MS)
+                    {
+                        this->clockDriftPpm += this->clockCorrectionMs * 1000000.0 / this->clockCorrectionSpanMs;
+                        this->clockDriftPpm = constrain(this->clockDriftPpm, -TS_CLOCK_DRIFT_PPM_MAX, TS_CLOCK_DRIFT_PPM_MAX);
+                        this->clockCorrectionMs = 0;
+                        this->clockCorrectionSpanMs = 0;
+                    }
+                    
+                    this->clockEpoch = serverTime;
+                    this->clockMillis = receivedMillis - (offset + correction);
+                    
+                    #ifdef PRINT_DEBUG_MESSAGES
+                        if(0 != correction)
+                        {
+                            Serial.print(F("               Clock corrected by ")); Serial.print(correction); Serial.print(F(" ms (drift ")); Serial.print(this->clockDriftPpm); Serial.println(F(" ppm)"));
+                        }
+                    #endif
+                    return;
+                }
+            }
+            
+            // First server time, or the clock is too far off to slew: assume the response arrived in the middle of the second
+            this->clockEpoch = serverTime;
+            this->clockMillis = receivedMillis - 500;
+            this->clockCorrectionMs = 0;
+            this->clockCorrectionSpanMs = 0;
+            this->clockSynced = true;
+            
+            #ifdef PRINT_DEBUG_MESSAGES
+                Serial.print(F("               Clock set to ")); Serial.println(serverTime);
+            #endif
         }
         
         
@@ -1635,17 +5467,88 @@
             return TS_OK_SUCCESS;
         }
 
-        float convertStringToFloat(String value)
+        bool readNumberField(unsigned long channelNumber, unsigned int field, char * valueString, size_t cap, const char * readAPIKey)
+        {
+            // A body longer than TS_NUMBER_LENGTH_MAX is reported as -101, rather than parsing a truncated number
+            return readStringField(channelNumber, field, valueString, cap, readAPIKey) >= 0;
+        }
+        
+        float convertCharToFloat(const char * value)
         {
-            // There's a bug in the AVR function strtod that it doesn't decode -INF correctly (it maps it to INF)
-            float result = value.toFloat();
+            while(isspace(*value)) value++;
             
-            if(1 == isinf(result) && *value.c_str() == '-')
+            // Decode the sign ourselves; there's a bug in the AVR function strtod that it doesn't decode -INF correctly (it maps it to INF)
+            bool negative = ('-' == *value);
+            if('-' == *value || '+' == *value) value++;
+            
+            float result;
+            if(isWordNoCase(value, F("nan")))
+            {
+                result = NAN;
+            }
+            else if(isWordNoCase(value, F("inf")) || isWordNoCase(value, F("infinity")))
+            {
+                result = INFINITY;
+            }
+            else if(isdigit(*value) || '.' == *value)
+            {
+                // Values beyond the float range decode as INFINITY
+                result = (float)strtod(value, NULL);
+            }
+            else
             {
-                result = (float)-INFINITY;
+                // Empty or text values decode as 0; strtod would take e.g. "infrared" as INFINITY
+                result = 0;
             }
             
-            return result;
+            return negative ? -result : result;
+        }
+        
+        bool startsWithNoCase(const char * text, const __FlashStringHelper * prefix)
+        {
+            // prefix is lower case, and kept in flash memory
+            for(const char * flashPrefix = reinterpret_cast<const char *>(prefix); ; text++, flashPrefix++)
+            {
+                char c = pgm_read_byte(flashPrefix);
+                if('\0' == c) return true;
+                if(tolower(*text) != c) return false;
+            }
+        }
+        
+        bool isWordNoCase(const char * text, const __FlashStringHelper * word)
+        {
+            // The whole value is the word, apart from trailing white space
+            if(!startsWithNoCase(text, word)) return false;
+            for(text += strlen_P(reinterpret_cast<const char *>(word)); '\0' != *text; text++)
+            {
+                if(!isspace(*text)) return false;
+            }
+            return true;
+        }
+        
+        long convertCharToLong(const char * value)
+        {
+            while(isspace(*value)) value++;
+            
+            bool negative = ('-' == *value);
+            if('-' == *value || '+' == *value) value++;
+            
+            // Stop at the first non-digit (e.g. the decimal point), and saturate instead of overflowing
+            unsigned long limit = negative ? (unsigned long)LONG_MAX + 1UL : (unsigned long)LONG_MAX;
+            unsigned long result = 0;
+            while(isdigit(*value))
+            {
+                unsigned int digit = *value - '0';
+                if(result > (limit - digit) / 10)
+                {
+                    result = limit;
+                    break;
+                }
+                result = result * 10 + digit;
+                value++;
+            }
+            
+            return negative ? (long)(0UL - result) : (long)result;
         }
 
         void resetWriteFields()
@@ -1659,6 +5562,9 @@
             this->nextWriteElevation = NAN;
             this->nextWriteStatus = "";
             this->nextWriteCreatedAt = "";
+            #ifndef ARDUINO_AVR_UNO
+                this->deadbandPendingFields = 0;
+            #endif
         }
     };
 